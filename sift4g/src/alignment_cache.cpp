@@ -0,0 +1,197 @@
+/*!
+ * @file alignment_cache.cpp
+ *
+ * @brief AlignmentCache class source file
+ *
+ * @author: rvaser
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils.hpp"
+#include "alignment_cache.hpp"
+
+/* entry layout:
+ *     kEntryMagic
+ *     key (query sequence, database fingerprint and parameters, one per line)
+ *     number of rows
+ *     name and residues of each row, one per line
+ *     kEntryEnd */
+constexpr char kEntryMagic[] = "SIFT4G_ALIGNMENT_CACHE_1\n";
+constexpr char kEntryEnd[] = "END\n";
+
+static uint64_t hashString(const std::string& str) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (const auto& it: str) {
+        hash ^= (unsigned char) it;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::unique_ptr<AlignmentCache> createAlignmentCache(const std::string& path,
+    const std::string& database_path, const std::string& parameters) {
+
+    createDirectory(path);
+
+    std::string fingerprint = fileFingerprint(database_path) + "\n" + parameters;
+
+    return std::unique_ptr<AlignmentCache>(new AlignmentCache(path, fingerprint));
+}
+
+AlignmentCache::AlignmentCache(const std::string& path, const std::string& fingerprint)
+        : path_(path), fingerprint_(fingerprint), temporary_id_(0) {
+}
+
+std::string AlignmentCache::key(Chain* query, float threshold) const {
+
+    std::string dst(chainGetLength(query), 0);
+    for (uint32_t i = 0; i < dst.size(); ++i) {
+        dst[i] = chainGetChar(query, i);
+    }
+
+    char median_threshold[64];
+    snprintf(median_threshold, sizeof(median_threshold), " median_threshold=%.9g\n", threshold);
+
+    return dst + "\n" + fingerprint_ + median_threshold;
+}
+
+std::string AlignmentCache::entryPath(const std::string& key) const {
+
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", (unsigned long long) hashString(key));
+
+    // entries are spread over 256 directories
+    return path_ + "/" + std::string(hash, 2) + "/" + std::string(hash + 2) + ".msa";
+}
+
+/* reads a line without the trailing newline, returns false if the newline is missing */
+static bool readLine(FILE* in, std::string& dst) {
+
+    dst.clear();
+
+    int c;
+    while ((c = getc(in)) != EOF) {
+        if (c == '\n') {
+            return true;
+        }
+        dst += (char) c;
+    }
+
+    return false;
+}
+
+/* parses the whole entry, rows are appended to dst unless it is nullptr */
+static bool readEntry(FILE* in, const std::string& key, uint32_t query_length, Msa* dst) {
+
+    std::string header(strlen(kEntryMagic) + key.size(), 0);
+    if (fread(&header[0], 1, header.size(), in) != header.size() ||
+        header.compare(0, strlen(kEntryMagic), kEntryMagic) != 0 ||
+        header.compare(strlen(kEntryMagic), key.size(), key) != 0) {
+        return false;
+    }
+
+    std::string name, residues;
+
+    if (!readLine(in, residues) || residues.empty() ||
+        residues.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    uint32_t rows = strtoul(residues.c_str(), nullptr, 10);
+
+    for (uint32_t i = 0; i < rows; ++i) {
+        if (!readLine(in, name) || !readLine(in, residues) || residues.size() != query_length) {
+            return false;
+        }
+        if (dst != nullptr) {
+            dst->append(name, residues.c_str());
+        }
+    }
+
+    char end[sizeof(kEntryEnd)] = {0};
+    return fread(end, 1, strlen(kEntryEnd), in) == strlen(kEntryEnd) &&
+        strcmp(end, kEntryEnd) == 0 && getc(in) == EOF;
+}
+
+bool AlignmentCache::contains(Chain* query, float threshold) const {
+
+    auto key = this->key(query, threshold);
+    auto entry_path = entryPath(key);
+
+    FILE* in = fopen(entry_path.c_str(), "r");
+    if (in == nullptr) {
+        return false;
+    }
+
+    bool is_valid = readEntry(in, key, chainGetLength(query), nullptr);
+
+    fclose(in);
+
+    if (!is_valid) {
+        fprintf(stderr, "* ignoring invalid cache entry '%s' for query [ %s ] *\n",
+            entry_path.c_str(), chainGetName(query));
+    }
+
+    return is_valid;
+}
+
+std::unique_ptr<Msa> AlignmentCache::load(Chain* query, float threshold) const {
+
+    auto key = this->key(query, threshold);
+    auto entry_path = entryPath(key);
+
+    FILE* in = fopen(entry_path.c_str(), "r");
+    if (in == nullptr) {
+        return nullptr;
+    }
+
+    auto dst = createMsa(chainGetLength(query));
+
+    bool is_valid = readEntry(in, key, chainGetLength(query), dst.get());
+
+    fclose(in);
+
+    if (!is_valid) {
+        return nullptr;
+    }
+
+    return dst;
+}
+
+void AlignmentCache::store(Chain* query, float threshold, const Msa* alignment_strings) {
+
+    auto key = this->key(query, threshold);
+    auto entry_path = entryPath(key);
+
+    std::string data = kEntryMagic + key;
+
+    uint32_t rows = alignment_strings == nullptr ? 0 : alignment_strings->size();
+    data += std::to_string(rows) + "\n";
+
+    for (uint32_t i = 0; i < rows; ++i) {
+        data += alignment_strings->name(i) + "\n";
+        const uint8_t* row = alignment_strings->row(i);
+        for (uint32_t j = 0; j < alignment_strings->length(); ++j) {
+            data += msaDecode(row[j]);
+        }
+        data += "\n";
+    }
+    data += kEntryEnd;
+
+    createDirectory(entry_path.substr(0, entry_path.find_last_of('/')));
+
+    std::string temporary_path = entry_path + ".tmp." + std::to_string((long long) getpid()) +
+        "." + std::to_string(temporary_id_++);
+
+    FILE* out = fopen(temporary_path.c_str(), "w");
+    ASSERT(out, "unable to open file '%s'", temporary_path.c_str());
+    ASSERT(fwrite(data.data(), 1, data.size(), out) == data.size() && fclose(out) == 0,
+        "unable to write file '%s'", temporary_path.c_str());
+
+    ASSERT(rename(temporary_path.c_str(), entry_path.c_str()) == 0,
+        "unable to rename file '%s'", temporary_path.c_str());
+}
@@ -0,0 +1,65 @@
+/*!
+ * @file alignment_cache.hpp
+ *
+ * @brief AlignmentCache class header file
+ *
+ * @author: rvaser
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <memory>
+#include <atomic>
+
+#include "msa.hpp"
+
+#include "swsharp/swsharp.h"
+
+class AlignmentCache;
+
+/* parameters should contain every option which changes database search or alignment,
+the median threshold of selection is part of each key, the database is identified
+by its path, size and modification time */
+std::unique_ptr<AlignmentCache> createAlignmentCache(const std::string& path,
+    const std::string& database_path, const std::string& parameters);
+
+/*!
+ * @brief Directory of selected alignments keyed by query sequence, database and
+ * parameters. Entries are written to temporary files and renamed, so processes
+ * sharing the directory read either whole entries or none. Entries are never
+ * removed, delete the directory to invalidate the cache.
+ */
+class AlignmentCache {
+public:
+
+    ~AlignmentCache() {};
+
+    /* true if a complete and valid entry for the query exists, invalid entries
+    are reported and can be replaced with store() */
+    bool contains(Chain* query, float threshold) const;
+
+    /* returns nullptr if the entry is missing or invalid (which can only happen if it
+    was modified after contains() returned true) */
+    std::unique_ptr<Msa> load(Chain* query, float threshold) const;
+
+    /* alignment_strings equal to nullptr stores a query without selected alignments */
+    void store(Chain* query, float threshold, const Msa* alignment_strings);
+
+    friend std::unique_ptr<AlignmentCache> createAlignmentCache(const std::string& path,
+        const std::string& database_path, const std::string& parameters);
+
+private:
+
+    AlignmentCache(const std::string& path, const std::string& fingerprint);
+    AlignmentCache(const AlignmentCache&) = delete;
+    const AlignmentCache& operator=(const AlignmentCache&) = delete;
+
+    std::string key(Chain* query, float threshold) const;
+    std::string entryPath(const std::string& key) const;
+
+    std::string path_;
+    std::string fingerprint_;
+    std::atomic<uint32_t> temporary_id_;
+};
@@ -0,0 +1,110 @@
+/*!
+ * @file async_writer.cpp
+ *
+ * @brief AsyncWriter class source file
+ *
+ * @author: rvaser
+ */
+
+#include <stdio.h>
+
+#include "utils.hpp"
+#include "async_writer.hpp"
+
+/* writers wait once this many bytes are waiting to be written */
+constexpr uint64_t kMaxQueuedBytes = 256ULL << 20;
+
+std::unique_ptr<AsyncWriter> createAsyncWriter(const std::string& archive_path) {
+
+    std::unique_ptr<OutputArchive> archive;
+    if (!archive_path.empty()) {
+        archive = createOutputArchive(archive_path);
+    }
+
+    return std::unique_ptr<AsyncWriter>(new AsyncWriter(std::move(archive)));
+}
+
+AsyncWriter::AsyncWriter(std::unique_ptr<OutputArchive> archive)
+        : queued_bytes_(0), terminate_(false), archive_(std::move(archive)) {
+    thread_ = std::thread(&AsyncWriter::run, this);
+}
+
+AsyncWriter::~AsyncWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        terminate_ = true;
+    }
+    condition_.notify_all();
+    thread_.join();
+
+    // writes the archive index
+    archive_.reset();
+}
+
+void AsyncWriter::write(const std::string& path, std::string&& data) {
+    push(path, std::move(data), kWriteFile);
+}
+
+void AsyncWriter::append(const std::string& path, std::string&& data) {
+    push(path, std::move(data), kAppendFile);
+}
+
+void AsyncWriter::add(const std::string& name, std::string&& data) {
+    ASSERT(archive_ != nullptr, "unable to store record '%s' without an archive", name.c_str());
+    push(name, std::move(data), kAddRecord);
+}
+
+void AsyncWriter::push(const std::string& path, std::string&& data, WriteMode mode) {
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this]() { return queued_bytes_ < kMaxQueuedBytes; });
+
+    queued_bytes_ += data.size();
+    files_.emplace_back(path, std::move(data), mode);
+
+    condition_.notify_all();
+}
+
+void AsyncWriter::run() {
+
+    while (true) {
+        std::tuple<std::string, std::string, WriteMode> file;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this]() { return terminate_ || !files_.empty(); });
+            if (files_.empty()) {
+                break;
+            }
+            file.swap(files_.front());
+            files_.pop_front();
+        }
+
+        const auto& path = std::get<0>(file);
+        const auto& data = std::get<1>(file);
+
+        if (std::get<2>(file) == kAppendFile) {
+            writeFile(path, data, "a");
+        } else if (std::get<2>(file) == kAddRecord) {
+            archive_->add(path, data);
+        } else if (archive_ != nullptr) {
+            archive_->add(path.substr(path.find_last_of('/') + 1), data);
+        } else {
+            writeFile(path, data, "w");
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queued_bytes_ -= data.size();
+        }
+        condition_.notify_all();
+    }
+}
+
+void AsyncWriter::writeFile(const std::string& path, const std::string& data, const char* mode) {
+
+    FILE* out = fopen(path.c_str(), mode);
+    ASSERT(out, "unable to open file '%s'", path.c_str());
+    ASSERT(fwrite(data.data(), 1, data.size(), out) == data.size(),
+        "unable to write file '%s'", path.c_str());
+    fclose(out);
+}
@@ -0,0 +1,74 @@
+/*!
+ * @file async_writer.hpp
+ *
+ * @brief AsyncWriter class header file
+ *
+ * @author: rvaser
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <deque>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "output_archive.hpp"
+
+class AsyncWriter;
+
+/* if archive_path is not empty files are stored as records of one archive,
+named by the last component of their path */
+std::unique_ptr<AsyncWriter> createAsyncWriter(const std::string& archive_path);
+
+/*!
+ * @brief Writes whole files on a dedicated thread so that thread pool tasks do
+ * not block on disk. Files are written in the order they were passed to write(),
+ * the destructor returns after all of them are written.
+ */
+class AsyncWriter {
+public:
+
+    ~AsyncWriter();
+
+    /* blocks only if too much data is already waiting to be written */
+    void write(const std::string& path, std::string&& data);
+
+    /* appends data to a file, appended files are never stored in the archive */
+    void append(const std::string& path, std::string&& data);
+
+    /* stores data as an archive record named exactly name (e.g. a query name which
+    contains '/'), the writer must have an archive */
+    void add(const std::string& name, std::string&& data);
+
+    friend std::unique_ptr<AsyncWriter> createAsyncWriter(const std::string& archive_path);
+
+private:
+
+    AsyncWriter(std::unique_ptr<OutputArchive> archive);
+    AsyncWriter(const AsyncWriter&) = delete;
+    const AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+    enum WriteMode {
+        kWriteFile,
+        kAppendFile,
+        kAddRecord
+    };
+
+    void push(const std::string& path, std::string&& data, WriteMode mode);
+    void run();
+    void writeFile(const std::string& path, const std::string& data, const char* mode);
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    // path (or record name), data and how data is written
+    std::deque<std::tuple<std::string, std::string, WriteMode>> files_;
+    uint64_t queued_bytes_;
+    bool terminate_;
+    std::unique_ptr<OutputArchive> archive_;
+    std::thread thread_;
+};
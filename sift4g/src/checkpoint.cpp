@@ -0,0 +1,259 @@
+/*!
+ * @file checkpoint.cpp
+ *
+ * @brief Checkpoint class source file
+ *
+ * @author: rvaser
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#include "utils.hpp"
+#include "checkpoint.hpp"
+
+constexpr char kLockFile[] = "lock";
+constexpr char kRunFile[] = "run.txt";
+constexpr char kSearchFile[] = "search.bin";
+constexpr char kAlignmentFile[] = "alignment_file.done";
+constexpr char kCompletedPrefix[] = "completed_";
+
+/* search file layout (integers in native byte order):
+ *     kSearchMagic
+ *     uint64 database cells, uint32 number of queries
+ *     for each query: uint32 query index, uint32 number of candidates, uint32 candidates */
+constexpr char kSearchMagic[] = "S4GSRCH1";
+constexpr uint32_t kMagicLength = 8;
+
+static uint64_t hashString(const std::string& str) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (const auto& it: str) {
+        hash ^= (unsigned char) it;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* returns the descriptor of the locked lock file of the directory (created with its
+parent if missing) or -1 if another process holds the lock */
+static int lockDirectory(const std::string& parent_path, const std::string& path) {
+
+    std::string lock_path = path + "/" + kLockFile;
+
+    while (true) {
+        // directories are removed by finishing runs, so they are created on each try
+        createDirectory(parent_path);
+        createDirectory(path);
+
+        int fd = open(lock_path.c_str(), O_RDWR | O_CREAT, 0666);
+        if (fd == -1 && errno == ENOENT) {
+            continue;
+        }
+        ASSERT(fd != -1, "unable to open file '%s'", lock_path.c_str());
+
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            ASSERT(errno == EWOULDBLOCK, "unable to lock file '%s'", lock_path.c_str());
+            close(fd);
+            return -1;
+        }
+
+        // a finishing run removes the lock file before releasing it, the lock is
+        // valid only if the file is still in place
+        struct stat locked, current;
+        if (fstat(fd, &locked) == 0 && stat(lock_path.c_str(), &current) == 0 &&
+            locked.st_dev == current.st_dev && locked.st_ino == current.st_ino) {
+            return fd;
+        }
+
+        close(fd);
+    }
+}
+
+std::string completedLine(uint32_t query_index, Chain* query) {
+    return std::to_string(query_index) + "\t" + chainGetName(query) + "\n";
+}
+
+std::unique_ptr<Checkpoint> createCheckpoint(const std::string& path, const std::string& run) {
+
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", (unsigned long long) hashString(run));
+    std::string run_directory = path + "/" + hash;
+
+    int lock_fd = lockDirectory(path, run_directory);
+    if (lock_fd == -1) {
+        fprintf(stderr, "** Checkpoint '%s' is used by another run, continuing without "
+            "checkpoint **\n\n", run_directory.c_str());
+        return nullptr;
+    }
+
+    std::string run_path = run_directory + "/" + kRunFile;
+
+    std::string data;
+    bool is_resumed = readFile(run_path, data) && data == run;
+
+    auto checkpoint = std::unique_ptr<Checkpoint>(new Checkpoint(path, run_directory,
+        is_resumed, lock_fd));
+
+    if (!is_resumed) {
+        checkpoint->clear();
+        replaceFile(run_path, run);
+        return checkpoint;
+    }
+
+    // completed lines are valid only if terminated by a newline
+    for (uint32_t i = 0; readFile(checkpoint->completedPath(i), data); ++i) {
+        checkpoint->completed_.emplace_back();
+        for (uint64_t begin = 0, end; (end = data.find('\n', begin)) != std::string::npos; begin = end + 1) {
+            checkpoint->completed_.back().emplace(data, begin, end - begin + 1);
+        }
+    }
+
+    return checkpoint;
+}
+
+Checkpoint::Checkpoint(const std::string& base_path, const std::string& path, bool is_resumed,
+    int lock_fd)
+        : base_path_(base_path), path_(path), is_resumed_(is_resumed), lock_fd_(lock_fd),
+        completed_() {
+}
+
+Checkpoint::~Checkpoint() {
+    if (lock_fd_ != -1) {
+        close(lock_fd_);
+    }
+}
+
+bool Checkpoint::loadSearch(std::vector<std::vector<uint32_t>>& dst, uint64_t& database_cells,
+    const std::vector<uint32_t>& query_indices) const {
+
+    std::string data;
+    if (!readFile(path_ + "/" + kSearchFile, data) || data.compare(0, kMagicLength, kSearchMagic) != 0) {
+        return false;
+    }
+
+    uint64_t i = kMagicLength;
+    uint32_t queries_length = 0;
+    if (!readValue(data, i, database_cells) || !readValue(data, i, queries_length)) {
+        return false;
+    }
+
+    // offsets of the candidates of each stored query
+    std::vector<std::pair<uint32_t, uint64_t>> stored;
+    for (uint32_t j = 0; j < queries_length; ++j) {
+        uint32_t query_index, candidates_length;
+        if (!readValue(data, i, query_index) || !readValue(data, i, candidates_length) ||
+            i + candidates_length * (uint64_t) sizeof(uint32_t) > data.size()) {
+            return false;
+        }
+        stored.emplace_back(query_index, i);
+        i += candidates_length * (uint64_t) sizeof(uint32_t);
+    }
+    std::sort(stored.begin(), stored.end());
+
+    dst.assign(query_indices.size(), std::vector<uint32_t>());
+    for (uint32_t j = 0; j < query_indices.size(); ++j) {
+        auto it = std::lower_bound(stored.begin(), stored.end(),
+            std::make_pair(query_indices[j], (uint64_t) 0));
+        if (it == stored.end() || it->first != query_indices[j]) {
+            return false;
+        }
+
+        i = it->second - sizeof(uint32_t);
+        uint32_t candidates_length = 0;
+        readValue(data, i, candidates_length);
+
+        dst[j].resize(candidates_length);
+        memcpy(dst[j].data(), &data[i], candidates_length * sizeof(uint32_t));
+    }
+
+    return true;
+}
+
+void Checkpoint::storeSearch(const std::vector<std::vector<uint32_t>>& indices, uint64_t database_cells,
+    const std::vector<uint32_t>& query_indices) {
+
+    std::string data = kSearchMagic;
+    appendValue<uint64_t>(data, database_cells);
+    appendValue<uint32_t>(data, query_indices.size());
+
+    for (uint32_t i = 0; i < query_indices.size(); ++i) {
+        appendValue<uint32_t>(data, query_indices[i]);
+        appendValue<uint32_t>(data, indices[i].size());
+        data.append((const char*) indices[i].data(), indices[i].size() * sizeof(uint32_t));
+    }
+
+    replaceFile(path_ + "/" + kSearchFile, data);
+}
+
+bool Checkpoint::isAlignmentFileWritten() const {
+    return isExtantPath((path_ + "/" + kAlignmentFile).c_str()) == 1;
+}
+
+void Checkpoint::setAlignmentFileWritten() {
+    replaceFile(path_ + "/" + kAlignmentFile, "");
+}
+
+std::string Checkpoint::completedPath(uint32_t setting) const {
+    return path_ + "/" + kCompletedPrefix + std::to_string(setting) + ".txt";
+}
+
+bool Checkpoint::isCompleted(uint32_t query_index, Chain* query, uint32_t settings_length) const {
+
+    if (completed_.size() < settings_length) {
+        return false;
+    }
+
+    auto line = completedLine(query_index, query);
+    for (uint32_t i = 0; i < settings_length; ++i) {
+        if (completed_[i].count(line) == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Checkpoint::clear() {
+
+    // only files created by a checkpoint are removed
+    for (const auto& it: { kRunFile, kSearchFile, kAlignmentFile }) {
+        ::remove((path_ + "/" + it).c_str());
+        ::remove((path_ + "/" + it + ".tmp").c_str());
+    }
+
+    DIR* directory = opendir(path_.c_str());
+    if (directory != nullptr) {
+        struct dirent* entry;
+        while ((entry = readdir(directory)) != nullptr) {
+            if (strncmp(entry->d_name, kCompletedPrefix, strlen(kCompletedPrefix)) == 0) {
+                ::remove((path_ + "/" + entry->d_name).c_str());
+            }
+        }
+        closedir(directory);
+    }
+
+    completed_.clear();
+}
+
+void Checkpoint::remove() {
+
+    clear();
+
+    // the lock file is removed while it is locked, see lockDirectory
+    ::remove((path_ + "/" + kLockFile).c_str());
+    rmdir(path_.c_str());
+
+    close(lock_fd_);
+    lock_fd_ = -1;
+
+    // fails if checkpoints of other runs or other files are present
+    rmdir(base_path_.c_str());
+}
@@ -0,0 +1,93 @@
+/*!
+ * @file checkpoint.hpp
+ *
+ * @brief Checkpoint class header file
+ *
+ * @author: rvaser
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_set>
+
+#include "swsharp/swsharp.h"
+
+class Checkpoint;
+
+/* run identifies the run (input files and every option which changes the outputs),
+its checkpoint is kept in a subdirectory of path named after a hash of run, so runs
+sharing path do not interfere; the subdirectory is locked until the checkpoint is
+destroyed, nullptr is returned if another process holds the lock */
+std::unique_ptr<Checkpoint> createCheckpoint(const std::string& path, const std::string& run);
+
+/*!
+ * @brief Work directory from which an interrupted run is resumed. It holds the
+ * candidate indices of database search, the state of the alignment file and a log
+ * of completed queries for each prediction setting; queries which were not completed
+ * are aligned again from their candidates. Files are replaced atomically or appended
+ * to after the data they mark is written, so a run can be interrupted at any point.
+ */
+class Checkpoint {
+public:
+
+    ~Checkpoint();
+
+    const std::string& path() const {
+        return path_;
+    }
+
+    /* true if a checkpoint of the same run was found */
+    bool isResumed() const {
+        return is_resumed_;
+    }
+
+    /* returns false unless candidate indices of all queries (given by their index)
+    were stored */
+    bool loadSearch(std::vector<std::vector<uint32_t>>& dst, uint64_t& database_cells,
+        const std::vector<uint32_t>& query_indices) const;
+
+    void storeSearch(const std::vector<std::vector<uint32_t>>& indices, uint64_t database_cells,
+        const std::vector<uint32_t>& query_indices);
+
+    /* true once the alignment file of --sub-results was written */
+    bool isAlignmentFileWritten() const;
+
+    void setAlignmentFileWritten();
+
+    /* log of completed queries of one prediction setting, lines are created with
+    completedLine() */
+    std::string completedPath(uint32_t setting) const;
+
+    /* true if the query is completed in the first settings_length settings */
+    bool isCompleted(uint32_t query_index, Chain* query, uint32_t settings_length) const;
+
+    /* removes the files of the checkpoint, its directory and path if they are empty,
+    called after a successful run */
+    void remove();
+
+    friend std::unique_ptr<Checkpoint> createCheckpoint(const std::string& path,
+        const std::string& run);
+
+private:
+
+    Checkpoint(const std::string& base_path, const std::string& path, bool is_resumed,
+        int lock_fd);
+    Checkpoint(const Checkpoint&) = delete;
+    const Checkpoint& operator=(const Checkpoint&) = delete;
+
+    void clear();
+
+    std::string base_path_;
+    std::string path_;
+    bool is_resumed_;
+    int lock_fd_;
+    // completed lines of each setting
+    std::vector<std::unordered_set<std::string>> completed_;
+};
+
+/* line of the completed queries log */
+std::string completedLine(uint32_t query_index, Chain* query);
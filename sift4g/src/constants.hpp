@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <algorithm>
+
 constexpr double kLog_2_20 = 4.321928095;
 
 /* generate from default.rank, but re-orderd to alphabet index using
@@ -40,6 +42,16 @@ constexpr int rank_matrix[26][26] = {
     { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}
 };
 
+/* valid_amino_acid for codes 'A' - 'Z', false for B, J, O, U, X and Z */
+constexpr bool valid_aa[26] = {
+    true, false, true, true, true, true, true, true, true, false, true, true, true, true, false, true, true, true, true, true, false, true, true, false, true, false
+};
+
+/* valid_aa as multiplication mask, padded to 32 entries */
+constexpr double valid_aa_mask[32] = {
+    1, 0, 1, 1, 1, 1, 1, 1, 1, 0, 1, 1, 1, 1, 0, 1, 1, 1, 1, 1, 0, 1, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0
+};
+
 /*
     13-component Dirichlet
     Name = merge-opt.13comp
@@ -74,13 +86,24 @@ const double diri_alpha[13][26] = {
 };
 
 
+/* the last element is excluded from sorting (kept for compatibility with
+the original implementation), nth_element is used instead of a full sort */
 static float getMedian(float* a, int len) {
 
-    std::sort(&a[0], &a[len - 1]);
+    int sort_len = len - 1;
+
+    auto select = [&](int k) -> float {
+        if (k < sort_len) {
+            std::nth_element(&a[0], &a[k], &a[sort_len]);
+        }
+        return a[k];
+    };
 
     if (len % 2 == 0) {
-        return (a[len / 2 - 1] + a[len / 2]) / 2.0;
+        float upper = select(len / 2);
+        float lower = len / 2 < sort_len ? *std::max_element(&a[0], &a[len / 2]) : a[len / 2 - 1];
+        return (lower + upper) / 2.0;
     } else {
-        return a[len / 2];
+        return select(len / 2);
     }
 }
@@ -18,6 +18,13 @@ void valueFunction(double* values, int* scores, Chain* query, Chain** database,
 void createFilteredDatabase(std::vector<uint32_t>& used_indices, Chain*** filtered_database,
     std::vector<uint32_t>& indices, Chain** database, uint32_t database_length);
 
+void alignDatabasePart(DbAlignment*** alignments, int* alignments_lengths,
+    std::vector<bool>& used_sequences, Chain** database, int32_t database_length,
+    Chain** queries, int32_t queries_length, std::vector<std::vector<uint32_t>>& indices,
+    int32_t algorithm, EValueParams* evalue_params, double max_evalue,
+    uint32_t max_alignments, Scorer* scorer, int32_t* cards, int32_t cards_length,
+    bool log, uint32_t part, float part_size);
+
 void alignDatabase(DbAlignment**** alignments, int** alignments_lengths, Chain*** _database,
     int32_t* _database_length, const std::string& database_path, Chain** queries,
     int32_t queries_length, std::vector<std::vector<uint32_t>>& indices,
@@ -38,7 +45,6 @@ void alignDatabase(DbAlignment**** alignments, int** alignments_lengths, Chain**
 
     uint32_t part = 1;
     float part_size = database_chunk / (float) 1000000000;
-    uint32_t log_size = queries_length / (100. / log_step_percentage);
 
     while (true) {
 
@@ -49,50 +55,15 @@ void alignDatabase(DbAlignment**** alignments, int** alignments_lengths, Chain**
 
         databaseLog(part, part_size, 0);
 
-        uint32_t log_counter = 0;
-        float log_percentage = log_step_percentage;
-
         /* have to malloc... */
         DbAlignment*** alignments_part = (DbAlignment***) malloc(queries_length * sizeof(DbAlignment**));
         int* alignments_part_lengths = (int*) malloc(queries_length * sizeof(int));
 
         std::vector<bool> used_sequences(database_length, false);
 
-        for (int32_t i = 0; i < queries_length; ++i) {
-
-            ++log_counter;
-            if (log_size != 0 && log_counter % log_size == 0 && log_percentage < 100.) {
-                databaseLog(part, part_size, log_percentage);
-                log_percentage += log_step_percentage;
-            }
-
-            std::vector<uint32_t> used_indices;
-            Chain** filtered_database = nullptr;
-            createFilteredDatabase(used_indices, &filtered_database, indices[i],
-                database, database_length);
-
-            if (used_indices.empty()) {
-                alignments_part[i] = nullptr;
-                alignments_part_lengths[i] = 0;
-                continue;
-            }
-
-            ChainDatabase* chain_database = chainDatabaseCreate(filtered_database, 0,
-                used_indices.size(), cards, cards_length);
-
-            alignDatabase(&alignments_part[i], &alignments_part_lengths[i], algorithm,
-                queries[i], chain_database, scorer, max_alignments, valueFunction,
-                (void*) evalue_params, max_evalue, nullptr, 0, cards,
-                cards_length, nullptr);
-
-            for (int32_t j = 0; j < alignments_part_lengths[i]; ++j) {
-                used_sequences[used_indices[dbAlignmentGetTargetIdx(alignments_part[i][j])]] = true;
-            }
-
-            chainDatabaseDelete(chain_database);
-
-            delete[] filtered_database;
-        }
+        alignDatabasePart(alignments_part, alignments_part_lengths, used_sequences, database,
+            database_length, queries, queries_length, indices, algorithm, evalue_params,
+            max_evalue, max_alignments, scorer, cards, cards_length, true, part, part_size);
 
         if (*alignments == nullptr) {
             *alignments = alignments_part;
@@ -126,6 +97,72 @@ void alignDatabase(DbAlignment**** alignments, int** alignments_lengths, Chain**
     *_database_length = database_length;
 }
 
+void alignDatabase(DbAlignment**** alignments, int** alignments_lengths, Chain** database,
+    int32_t database_length, Chain** queries, int32_t queries_length,
+    std::vector<std::vector<uint32_t>>& indices, int32_t algorithm, EValueParams* evalue_params,
+    double max_evalue, uint32_t max_alignments, Scorer* scorer, int32_t* cards,
+    int32_t cards_length) {
+
+    *alignments = (DbAlignment***) malloc(queries_length * sizeof(DbAlignment**));
+    *alignments_lengths = (int*) malloc(queries_length * sizeof(int));
+
+    std::vector<bool> used_sequences(database_length, false);
+
+    alignDatabasePart(*alignments, *alignments_lengths, used_sequences, database,
+        database_length, queries, queries_length, indices, algorithm, evalue_params,
+        max_evalue, max_alignments, scorer, cards, cards_length, false, 0, 0);
+}
+
+/* aligns each query with its candidates among the first database_length sequences
+ * and marks the sequences of its alignments in used_sequences */
+void alignDatabasePart(DbAlignment*** alignments, int* alignments_lengths,
+    std::vector<bool>& used_sequences, Chain** database, int32_t database_length,
+    Chain** queries, int32_t queries_length, std::vector<std::vector<uint32_t>>& indices,
+    int32_t algorithm, EValueParams* evalue_params, double max_evalue,
+    uint32_t max_alignments, Scorer* scorer, int32_t* cards, int32_t cards_length,
+    bool log, uint32_t part, float part_size) {
+
+    uint32_t log_size = queries_length / (100. / log_step_percentage);
+    uint32_t log_counter = 0;
+    float log_percentage = log_step_percentage;
+
+    for (int32_t i = 0; i < queries_length; ++i) {
+
+        ++log_counter;
+        if (log && log_size != 0 && log_counter % log_size == 0 && log_percentage < 100.) {
+            databaseLog(part, part_size, log_percentage);
+            log_percentage += log_step_percentage;
+        }
+
+        std::vector<uint32_t> used_indices;
+        Chain** filtered_database = nullptr;
+        createFilteredDatabase(used_indices, &filtered_database, indices[i],
+            database, database_length);
+
+        if (used_indices.empty()) {
+            alignments[i] = nullptr;
+            alignments_lengths[i] = 0;
+            continue;
+        }
+
+        ChainDatabase* chain_database = chainDatabaseCreate(filtered_database, 0,
+            used_indices.size(), cards, cards_length);
+
+        alignDatabase(&alignments[i], &alignments_lengths[i], algorithm,
+            queries[i], chain_database, scorer, max_alignments, valueFunction,
+            (void*) evalue_params, max_evalue, nullptr, 0, cards,
+            cards_length, nullptr);
+
+        for (int32_t j = 0; j < alignments_lengths[i]; ++j) {
+            used_sequences[used_indices[dbAlignmentGetTargetIdx(alignments[i][j])]] = true;
+        }
+
+        chainDatabaseDelete(chain_database);
+
+        delete[] filtered_database;
+    }
+}
+
 void valueFunction(double* values, int* scores, Chain* query, Chain** database,
     int databaseLen, int* cards, int cardsLen, void* param_ ) {
 
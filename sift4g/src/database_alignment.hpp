@@ -21,3 +21,10 @@ void alignDatabase(DbAlignment**** alignments, int** alignments_lengths, Chain**
     int32_t algorithm, EValueParams* evalue_params, double max_evalue,
     uint32_t max_alignments, Scorer* scorer, int32_t* cards,
     int32_t cards_length);
+
+/* aligns with a database kept in memory without logging, its chains are not deleted */
+void alignDatabase(DbAlignment**** alignments, int** alignments_lengths, Chain** database,
+    int32_t database_length, Chain** queries, int32_t queries_length,
+    std::vector<std::vector<uint32_t>>& indices, int32_t algorithm, EValueParams* evalue_params,
+    double max_evalue, uint32_t max_alignments, Scorer* scorer, int32_t* cards,
+    int32_t cards_length);
@@ -0,0 +1,240 @@
+/*!
+ * @file database_clusters.cpp
+ *
+ * @brief Database duplicate clusters source file
+ *
+ * @author: rvaser
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
+#include "utils.hpp"
+#include "database_clusters.hpp"
+
+constexpr uint32_t database_chunk = 1000000000; /* ~1GB */
+
+/* file layout (integers in native byte order):
+ *     kClustersHeader
+ *     fingerprint of the database file (two lines)
+ *     uint32 number of sequences, uint32 representative of each sequence */
+constexpr char kClustersHeader[] = "sift4g database clusters 2";
+
+/* two independent 64-bit digests of a sequence, sequences read from the database file
+are not kept, so their 128-bit key has to tell them apart */
+typedef std::pair<uint64_t, uint64_t> ResidueKey;
+
+class ResidueKeyHash {
+public:
+    size_t operator()(const ResidueKey& key) const {
+        return key.first;
+    }
+};
+
+/* FNV-1a and a multiply-rotate hash over the length and residues of a sequence */
+static ResidueKey digestResidues(Chain* chain) {
+
+    uint64_t fnv = 14695981039346656037ULL;
+    uint64_t mix = 0x243F6A8885A308D3ULL;
+    auto update = [&fnv, &mix](const char* data, uint32_t length) -> void {
+        for (uint32_t i = 0; i < length; ++i) {
+            fnv ^= (unsigned char) data[i];
+            fnv *= 1099511628211ULL;
+            mix ^= (unsigned char) data[i];
+            mix = ((mix << 23) | (mix >> 41)) * 0x9E3779B97F4A7C15ULL;
+        }
+    };
+
+    uint32_t length = chainGetLength(chain);
+    update((const char*) &length, sizeof(length));
+    update(chainGetCodes(chain), length);
+
+    return ResidueKey(fnv, mix);
+}
+
+/* appends the representatives of chains[begin, end), keys holds the first sequence
+with each digest */
+static void clusterChains(std::vector<uint32_t>& dst,
+    std::unordered_map<ResidueKey, uint32_t, ResidueKeyHash>& keys, Chain** chains,
+    uint32_t begin, uint32_t end) {
+
+    for (uint32_t i = begin; i < end; ++i) {
+        dst.emplace_back(keys.emplace(digestResidues(chains[i]), i).first->second);
+    }
+}
+
+static bool isEqualChain(Chain* a, Chain* b) {
+    return chainGetLength(a) == chainGetLength(b) &&
+        memcmp(chainGetCodes(a), chainGetCodes(b), chainGetLength(a)) == 0;
+}
+
+std::string databaseClustersPath(const std::string& database_path) {
+    return database_path + ".clusters";
+}
+
+void createDatabaseClusters(std::vector<uint32_t>& dst, const std::string& database_path) {
+
+    fprintf(stderr, "** Clustering identical database sequences **\n");
+
+    dst.clear();
+    std::unordered_map<ResidueKey, uint32_t, ResidueKeyHash> keys;
+
+    Chain** database = nullptr;
+    int database_length = 0;
+    int database_start = 0;
+
+    FILE* handle = nullptr;
+    int serialized = 0;
+    readFastaChainsPartInit(&database, &database_length, &handle, &serialized,
+        database_path.c_str());
+
+    uint32_t part = 1;
+    float part_size = database_chunk / (float) 1000000000;
+
+    while (true) {
+
+        int status = readFastaChainsPart(&database, &database_length, handle,
+            serialized, database_chunk);
+
+        databaseLog(part, part_size, 0);
+
+        clusterChains(dst, keys, database, database_start, database_length);
+
+        for (int i = database_start; i < database_length; ++i) {
+            chainDelete(database[i]);
+            database[i] = nullptr;
+        }
+
+        databaseLog(part, part_size, 100);
+        ++part;
+
+        if (status == 0) {
+            break;
+        }
+
+        database_start = database_length;
+    }
+    fprintf(stderr, "\n\n");
+
+    fclose(handle);
+    deleteFastaChains(database, database_length);
+
+    std::string data = std::string(kClustersHeader) + "\n" + fileFingerprint(database_path) + "\n";
+    appendValue<uint32_t>(data, dst.size());
+    for (const auto& it: dst) {
+        appendValue<uint32_t>(data, it);
+    }
+
+    replaceFile(databaseClustersPath(database_path), data);
+}
+
+bool readDatabaseClusters(std::vector<uint32_t>& dst, const std::string& database_path) {
+
+    std::string data;
+    if (!readFile(databaseClustersPath(database_path), data)) {
+        return false;
+    }
+
+    std::string header = std::string(kClustersHeader) + "\n" + fileFingerprint(database_path) + "\n";
+    if (data.compare(0, header.size(), header) != 0) {
+        return false;
+    }
+
+    uint64_t i = header.size();
+    uint32_t length = 0;
+    if (!readValue(data, i, length)) {
+        return false;
+    }
+
+    std::vector<uint32_t> representatives(length);
+    for (uint32_t j = 0; j < length; ++j) {
+        if (!readValue(data, i, representatives[j]) || representatives[j] > j) {
+            return false;
+        }
+    }
+
+    dst.swap(representatives);
+    return true;
+}
+
+void createChainClusters(std::vector<uint32_t>& dst, Chain** chains, uint32_t chains_length) {
+
+    dst.clear();
+    dst.reserve(chains_length);
+
+    // representatives with each digest, sequences with equal digests are compared
+    std::unordered_map<ResidueKey, std::vector<uint32_t>, ResidueKeyHash> keys;
+
+    for (uint32_t i = 0; i < chains_length; ++i) {
+        auto& candidates = keys[digestResidues(chains[i])];
+
+        uint32_t representative = i;
+        for (const auto& it: candidates) {
+            if (isEqualChain(chains[it], chains[i])) {
+                representative = it;
+                break;
+            }
+        }
+
+        if (representative == i) {
+            candidates.emplace_back(i);
+        }
+        dst.emplace_back(representative);
+    }
+}
+
+uint32_t countRepresentatives(const std::vector<uint32_t>& representatives) {
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < representatives.size(); ++i) {
+        count += representatives[i] == i;
+    }
+    return count;
+}
+
+void expandDatabaseClusters(std::vector<std::vector<Candidate>>& candidates,
+    const std::vector<uint32_t>& budgets, const std::vector<uint32_t>& representatives) {
+
+    if (representatives.empty()) {
+        return;
+    }
+
+    // members of representative i are members[starts[i], starts[i + 1])
+    std::vector<uint32_t> starts(representatives.size() + 1, 0);
+    for (const auto& it: representatives) {
+        ++starts[it + 1];
+    }
+    for (uint32_t i = 0; i < representatives.size(); ++i) {
+        starts[i + 1] += starts[i];
+    }
+
+    std::vector<uint32_t> members(representatives.size());
+    std::vector<uint32_t> offsets(starts.begin(), starts.end() - 1);
+    for (uint32_t i = 0; i < representatives.size(); ++i) {
+        members[offsets[representatives[i]]++] = i;
+    }
+
+    for (uint32_t i = 0; i < candidates.size(); ++i) {
+        // members share the score of their representative, taking the best ones until
+        // the budget is used up gives the candidates of a search without clusters
+        std::stable_sort(candidates[i].begin(), candidates[i].end());
+
+        std::vector<Candidate> expanded;
+        for (const auto& it: candidates[i]) {
+            if (expanded.size() == budgets[i]) {
+                break;
+            }
+            if ((uint32_t) it.id >= representatives.size()) {
+                expanded.emplace_back(it);
+                continue;
+            }
+            for (uint32_t j = starts[it.id]; j < starts[it.id + 1] && expanded.size() < budgets[i]; ++j) {
+                expanded.emplace_back(it.score, members[j]);
+            }
+        }
+        candidates[i].swap(expanded);
+    }
+}
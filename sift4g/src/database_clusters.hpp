@@ -0,0 +1,48 @@
+/*!
+ * @file database_clusters.hpp
+ *
+ * @brief Database duplicate clusters header file
+ *
+ * @author: rvaser
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+#include "database_search.hpp"
+
+#include "swsharp/swsharp.h"
+
+/* Identical database sequences form a cluster represented by its first sequence,
+representatives are given as a vector holding the representative of each sequence
+(representatives[i] == i for representatives). Sequences read from the database file
+are compared by a 128-bit key made of two independent digests of their length and
+residues (different sequences with equal keys are not to be expected even in the
+largest databases); sequences of a database kept in memory are compared residue by
+residue. */
+
+/* path of the clusters file kept next to the database file */
+std::string databaseClustersPath(const std::string& database_path);
+
+/* reads the database once and writes its clusters file */
+void createDatabaseClusters(std::vector<uint32_t>& dst, const std::string& database_path);
+
+/* returns false if the clusters file is missing or was created for a different
+database file (by path, size and modification time) */
+bool readDatabaseClusters(std::vector<uint32_t>& dst, const std::string& database_path);
+
+/* clusters a database kept in memory */
+void createChainClusters(std::vector<uint32_t>& dst, Chain** chains, uint32_t chains_length);
+
+/* number of representatives */
+uint32_t countRepresentatives(const std::vector<uint32_t>& representatives);
+
+/* replaces each representative in candidates (of database search, one vector per query)
+with the members of its cluster, best scoring first, keeping at most budgets[i] candidates
+of query i, so a query gets the same number of candidates as without clusters; nothing
+is done if representatives is empty */
+void expandDatabaseClusters(std::vector<std::vector<Candidate>>& candidates,
+    const std::vector<uint32_t>& budgets, const std::vector<uint32_t>& representatives);
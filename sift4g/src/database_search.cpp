@@ -9,68 +9,134 @@
 #include <algorithm>
 #include <limits>
 #include <cmath>
+#include <string.h>
+#include <atomic>
+#include <map>
 
 #include "hash.hpp"
+#include "seg.hpp"
 #include "utils.hpp"
+#include "query_schedule.hpp"
+#include "search_state.hpp"
 #include "database_search.hpp"
+#include "database_clusters.hpp"
 
 constexpr uint32_t database_chunk = 250000000; /* ~250MB */
 constexpr float log_step_percentage = 2.5;
 
-class Candidate {
+constexpr uint64_t kDigestSeed = 14695981039346656037ULL;
+
+/* FNV-1a over the name and residues of a database sequence */
+static uint64_t digestChain(uint64_t digest, Chain* chain) {
+
+    auto update = [&digest](const char* data, uint32_t length) -> void {
+        for (uint32_t i = 0; i < length; ++i) {
+            digest ^= (unsigned char) data[i];
+            digest *= 1099511628211ULL;
+        }
+    };
+
+    const char* name = chainGetName(chain);
+    update(name, strlen(name) + 1);
+    update(chainGetCodes(chain), chainGetLength(chain));
+
+    return digest;
+}
+
+/* low-complexity masking of database sequences summed over all search tasks */
+class MaskingStats {
 public:
-    Candidate(float _score, int _id) :
-            score(_score), id(_id) {
+    MaskingStats()
+            : cells(0), residues(0), time(0) {
     }
 
-    bool operator<(const Candidate& other) const {
-        return this->score > other.score;
+    std::atomic<uint64_t> cells;
+    std::atomic<uint64_t> residues;
+    // microseconds
+    std::atomic<uint64_t> time;
+};
+
+/* queries searched with the same k-mer length and candidate budget, ids holds the index
+of each query of the group among all searched queries */
+class SearchGroup {
+public:
+    SearchGroup(uint32_t _kmer_length, uint32_t _max_candidates)
+            : ids(), kmer_length(_kmer_length), max_candidates(_max_candidates),
+            query_hash(nullptr), min_scores(), candidates() {
     }
 
-    float score;
-    int32_t id;
+    std::vector<uint32_t> ids;
+    uint32_t kmer_length;
+    uint32_t max_candidates;
+    std::shared_ptr<Hash> query_hash;
+    std::vector<float> min_scores;
+    // candidates of each search task, merged into candidates[0]
+    std::vector<std::vector<std::vector<Candidate>>> candidates;
 };
 
 class ThreadSearchData {
 public:
-    ThreadSearchData(std::shared_ptr<Hash> _query_hash, uint32_t _queries_length,
-        std::vector<float>& _min_scores, Chain** _database,
-        uint32_t _database_begin, uint32_t _database_end,
-        uint32_t _kmer_length, uint32_t _max_candidates,
-        std::vector<std::vector<Candidate>>& _candidates,
-        bool _log, uint32_t _part, float _part_size):
-            query_hash(_query_hash), queries_length(_queries_length), min_scores(_min_scores),
-            database(_database), database_begin(_database_begin), database_end(_database_end),
-            kmer_length(_kmer_length), max_candidates(_max_candidates), candidates(_candidates),
+    ThreadSearchData(std::vector<SearchGroup>& _groups, uint32_t _task, Chain** _database,
+        uint32_t _database_begin, uint32_t _database_end, MaskingStats* _masking,
+        const std::vector<uint32_t>* _representatives, bool _log, uint32_t _part,
+        float _part_size):
+            groups(_groups), task(_task), database(_database), database_begin(_database_begin),
+            database_end(_database_end), masking(_masking), representatives(_representatives),
             log(_log), part(_part), part_size(_part_size) {
     }
 
-    std::shared_ptr<Hash> query_hash;
-    uint32_t queries_length;
-    std::vector<float>& min_scores;
+    std::vector<SearchGroup>& groups;
+    uint32_t task;
     Chain** database;
     uint32_t database_begin;
     uint32_t database_end;
-    uint32_t kmer_length;
-    uint32_t max_candidates;
-    std::vector<std::vector<Candidate>>& candidates;
+    MaskingStats* masking;
+    const std::vector<uint32_t>* representatives;
     bool log;
     uint32_t part;
     float part_size;
 };
 
+void createSearchGroups(std::vector<SearchGroup>& dst, Chain** queries,
+    const std::vector<uint32_t>& ids, uint32_t kmer_length, uint32_t max_candidates,
+    bool adaptive);
+
+void initializeSearchGroups(std::vector<SearchGroup>& groups, Chain** queries, bool seg,
+    const std::map<uint32_t, std::vector<bool>>& stop_sets, uint32_t num_threads);
+
+void collectCandidates(std::vector<std::vector<Candidate>>& dst, std::vector<SearchGroup>& groups);
+
+void searchDatabasePart(std::vector<SearchGroup>& groups, Chain** database,
+    uint32_t database_begin, uint32_t database_end, uint32_t num_threads, MaskingStats* masking,
+    const std::vector<uint32_t>* representatives, bool log, uint32_t part, float part_size);
+
+uint64_t createQueryStopWords(std::vector<bool>& dst, Chain** database, uint32_t database_length,
+    Chain** queries, int32_t queries_length, uint32_t kmer_length, uint32_t stop_words, bool seg, bool log);
+
+uint64_t createGroupStopWords(std::map<uint32_t, std::vector<bool>>& dst,
+    const std::vector<SearchGroup>& groups, Chain** database, uint32_t database_length,
+    Chain** queries, uint32_t stop_words, bool seg, bool log);
+
+void candidateBudgets(std::vector<uint32_t>& dst, const std::vector<SearchGroup>& groups,
+    uint32_t queries_length, uint32_t max_candidates);
+
+void candidatesToIndices(std::vector<std::vector<uint32_t>>& dst,
+    std::vector<std::vector<Candidate>>& candidates, uint32_t queries_length);
+
 void* threadSearchDatabase(void* params);
 
 int32_t longestIncreasingSubsequence(const std::vector<int32_t>& src);
 
 uint64_t searchDatabase(std::vector<std::vector<uint32_t>>& dst,
     const std::string& database_path, Chain** queries, int32_t queries_length,
-    uint32_t kmer_length, uint32_t max_candidates, uint32_t num_threads) {
+    uint32_t kmer_length, uint32_t max_candidates, uint32_t num_threads, bool seg,
+    uint32_t stop_words, bool adaptive, const std::vector<uint32_t>& representatives,
+    SearchState* state) {
 
     fprintf(stderr, "** Searching database for candidate sequences **\n");
 
-    std::shared_ptr<Hash> query_hash = createHash(queries, queries_length, 0,
-        queries_length, kmer_length);
+    // sequences which are not representatives are skipped
+    const std::vector<uint32_t>* clusters = representatives.empty() ? nullptr : &representatives;
 
     Chain** database = nullptr;
     int database_length = 0;
@@ -82,9 +148,28 @@ uint64_t searchDatabase(std::vector<std::vector<uint32_t>>& dst,
         database_path.c_str());
 
     uint64_t database_cells = 0;
+    uint64_t database_digest = kDigestSeed, searched_digest = kDigestSeed;
+
+    std::vector<uint32_t> ids(queries_length);
+    for (int32_t i = 0; i < queries_length; ++i) {
+        ids[i] = i;
+    }
+
+    std::vector<SearchGroup> groups;
+    createSearchGroups(groups, queries, ids, kmer_length, max_candidates, adaptive);
 
-    std::vector<float> min_scores(queries_length, 1000000.0);
-    std::vector<std::vector<std::vector<Candidate>>> candidates(num_threads);
+    // queries found in the state were searched in the first searched_length sequences,
+    // hashes are created once the first database part is read (stop words are counted in it)
+    uint32_t searched_length = 0;
+    std::vector<std::vector<Candidate>> stored(queries_length);
+
+    // new queries are compared with searched sequences separately
+    std::vector<SearchGroup> new_groups;
+
+    bool is_initialized = false;
+    uint64_t stop_words_digest = 0;
+
+    MaskingStats masking;
 
     uint32_t part = 1;
     float part_size = database_chunk / (float) 1000000000;
@@ -96,40 +181,414 @@ uint64_t searchDatabase(std::vector<std::vector<uint32_t>>& dst,
         status &= readFastaChainsPart(&database, &database_length, handle,
             serialized, database_chunk);
 
-        databaseLog(part, part_size, 0);
+        if (!is_initialized) {
 
-        uint32_t database_split_size = (database_length - database_start) / num_threads;
-        std::vector<uint32_t> database_splits(num_threads + 1, database_start);
-        for (uint32_t i = 1; i < num_threads; ++i) {
-            database_splits[i] += i * database_split_size;
-        }
-        database_splits[num_threads] = database_length;
+            // stop words are counted in the sequences searched before (if they are in this
+            // part), so sequences appended to a small database do not change them
+            uint32_t counted_length = database_length;
+            if (state != nullptr && state->databaseLength() != 0) {
+                counted_length = std::min<uint32_t>(state->databaseLength(), database_length);
+            }
+
+            std::map<uint32_t, std::vector<bool>> stop_sets;
+            if (stop_words != 0) {
+                stop_words_digest = createGroupStopWords(stop_sets, groups, database,
+                    counted_length, queries, stop_words, seg, true);
+            }
+
+            // candidates stored with other stop words are not comparable
+            if (state != nullptr && state->stopWordsDigest() != stop_words_digest) {
+                if (state->databaseLength() != 0) {
+                    fprintf(stderr, "** Stop words differ from the ones of the previous search, "
+                        "searching whole database **\n");
+                }
+                state->clear();
+            }
+            searched_length = state != nullptr ? state->databaseLength() : 0;
+
+            if (searched_length != 0) {
+                std::vector<uint32_t> new_ids;
+                for (int32_t i = 0; i < queries_length; ++i) {
+                    if (!state->find(stored[i], queries[i])) {
+                        new_ids.emplace_back(i);
+                    }
+                }
+
+                fprintf(stderr, "** %d of %d queries were searched before, comparing them with appended "
+                    "database sequences only **\n", queries_length - (int32_t) new_ids.size(), queries_length);
+
+                createSearchGroups(new_groups, queries, new_ids, kmer_length, max_candidates,
+                    adaptive);
+            }
+
+            initializeSearchGroups(groups, queries, seg, stop_sets, num_threads);
+            initializeSearchGroups(new_groups, queries, seg, stop_sets, num_threads);
 
-        std::vector<ThreadPoolTask*> thread_tasks(num_threads, nullptr);
+            is_initialized = true;
+        }
 
-        for (uint32_t i = 0; i < num_threads; ++i) {
+        databaseLog(part, part_size, 0);
 
-            auto thread_data = new ThreadSearchData(query_hash, queries_length, min_scores,
-                database, database_splits[i], database_splits[i + 1], kmer_length,
-                max_candidates, candidates[i], i == num_threads - 1, part,
-                part_size);
+        uint32_t searched_end = std::max<uint32_t>(database_start,
+            std::min<uint32_t>(searched_length, database_length));
 
-            thread_tasks[i] = threadPoolSubmit(threadSearchDatabase, (void*) thread_data);
+        if ((uint32_t) database_start < searched_end) {
+            searchDatabasePart(new_groups, database, database_start, searched_end, num_threads,
+                seg ? &masking : nullptr, clusters, false, part, part_size);
         }
 
-        for (uint32_t i = 0; i < num_threads; ++i) {
-            threadPoolTaskWait(thread_tasks[i]);
-            threadPoolTaskDelete(thread_tasks[i]);
+        if (searched_end < (uint32_t) database_length) {
+            searchDatabasePart(groups, database, searched_end, database_length, num_threads,
+                seg ? &masking : nullptr, clusters, true, part, part_size);
         }
 
         for (int i = database_start; i < database_length; ++i) {
+            if (state != nullptr) {
+                if ((uint32_t) i == searched_length) {
+                    searched_digest = database_digest;
+                }
+                database_digest = digestChain(database_digest, database[i]);
+            }
             database_cells += chainGetLength(database[i]);
             chainDelete(database[i]);
             database[i] = nullptr;
         }
 
-        // merge candidates from all threads
+        databaseLog(part, part_size, 100);
+        ++part;
+
+        if (status == 0) {
+            break;
+        }
+
+        database_start = database_length;
+    }
+    fprintf(stderr, "\n\n");
+
+    fclose(handle);
+    deleteFastaChains(database, database_length);
+
+    if (adaptive) {
+        for (const auto& it: groups) {
+            fprintf(stderr, "** Adaptive search: %zu queries with k-mer length %u and at most %u "
+                "candidates **\n", it.ids.size(), it.kmer_length, it.max_candidates);
+        }
+        fprintf(stderr, "\n");
+    }
+
+    if (seg) {
+        uint64_t query_cells = 0, query_masked = 0;
         for (int32_t i = 0; i < queries_length; ++i) {
+            query_cells += chainGetLength(queries[i]);
+        }
+        for (const auto& it: groups) {
+            query_masked += it.query_hash->maskedResidues();
+        }
+        fprintf(stderr, "** Low-complexity masking: %.2f%% of query and %.2f%% of searched database "
+            "residues masked, %.2f s of task time **\n\n",
+            100. * query_masked / std::max<uint64_t>(query_cells, 1),
+            100. * masking.residues / std::max<uint64_t>(masking.cells, 1), masking.time / 1e6);
+    }
+
+    std::vector<uint32_t> budgets;
+    candidateBudgets(budgets, groups, queries_length, max_candidates);
+
+    std::vector<std::vector<Candidate>> candidates(queries_length);
+    collectCandidates(candidates, groups);
+
+    if (state == nullptr) {
+        expandDatabaseClusters(candidates, budgets, representatives);
+        candidatesToIndices(dst, candidates, queries_length);
+        return database_cells;
+    }
+
+    if ((uint32_t) database_length == searched_length) {
+        searched_digest = database_digest;
+    }
+
+    if (searched_length != 0 && ((uint32_t) database_length < searched_length ||
+        searched_digest != state->databaseDigest())) {
+
+        fprintf(stderr, "** Previously searched database sequences changed, searching whole database **\n");
+        state->clear();
+        return searchDatabase(dst, database_path, queries, queries_length, kmer_length,
+            max_candidates, num_threads, seg, stop_words, adaptive, representatives, state);
+    }
+
+    collectCandidates(stored, new_groups);
+
+    // merge candidates of appended sequences with the ones of searched sequences
+    for (int32_t i = 0; i < queries_length; ++i) {
+        if (stored[i].empty()) {
+            continue;
+        }
+        candidates[i].insert(candidates[i].end(), stored[i].begin(), stored[i].end());
+        std::vector<Candidate>().swap(stored[i]);
+
+        std::sort(candidates[i].begin(), candidates[i].end());
+        if (candidates[i].size() > budgets[i]) {
+            candidates[i].resize(budgets[i], candidates[i].front());
+        }
+    }
+
+    // the state keeps candidate representatives
+    state->update(database_length, database_digest, stop_words_digest, queries, queries_length, candidates);
+
+    expandDatabaseClusters(candidates, budgets, representatives);
+    candidatesToIndices(dst, candidates, queries_length);
+
+    return database_cells;
+}
+
+std::vector<uint32_t> searchKmerLengths(uint32_t kmer_length, bool adaptive) {
+
+    if (!adaptive) {
+        return std::vector<uint32_t>(1, kmer_length);
+    }
+
+    std::vector<uint32_t> dst(kAdaptiveKmerLengths, kAdaptiveKmerLengths + kAdaptiveGroups);
+    std::sort(dst.begin(), dst.end());
+    dst.erase(std::unique(dst.begin(), dst.end()), dst.end());
+
+    return dst;
+}
+
+void createStopWordSets(std::map<uint32_t, std::vector<bool>>& dst, Chain** database,
+    int32_t database_length, const std::vector<uint32_t>& kmer_lengths, uint32_t stop_words,
+    bool seg) {
+
+    for (const auto& it: kmer_lengths) {
+        if (dst.count(it) != 0) {
+            continue;
+        }
+
+        std::vector<uint32_t> counts;
+        countKmers(counts, database, 0, database_length, it, seg);
+        createStopWords(dst[it], counts, stop_words);
+    }
+}
+
+uint64_t searchDatabase(std::vector<std::vector<uint32_t>>& dst,
+    Chain** database, int32_t database_length, Chain** queries, int32_t queries_length,
+    uint32_t kmer_length, uint32_t max_candidates, uint32_t num_threads, bool seg,
+    const std::map<uint32_t, std::vector<bool>>& stop_sets, bool adaptive,
+    const std::vector<uint32_t>& representatives) {
+
+    std::vector<uint32_t> ids(queries_length);
+    for (int32_t i = 0; i < queries_length; ++i) {
+        ids[i] = i;
+    }
+
+    std::vector<SearchGroup> groups;
+    createSearchGroups(groups, queries, ids, kmer_length, max_candidates, adaptive);
+
+    initializeSearchGroups(groups, queries, seg, stop_sets, num_threads);
+
+    MaskingStats masking;
+
+    searchDatabasePart(groups, database, 0, database_length, num_threads,
+        seg ? &masking : nullptr, representatives.empty() ? nullptr : &representatives,
+        false, 0, 0);
+
+    std::vector<uint32_t> budgets;
+    candidateBudgets(budgets, groups, queries_length, max_candidates);
+
+    std::vector<std::vector<Candidate>> candidates(queries_length);
+    collectCandidates(candidates, groups);
+    expandDatabaseClusters(candidates, budgets, representatives);
+    candidatesToIndices(dst, candidates, queries_length);
+
+    uint64_t database_cells = 0;
+    for (int32_t i = 0; i < database_length; ++i) {
+        database_cells += chainGetLength(database[i]);
+    }
+
+    return database_cells;
+}
+
+/* splits queries with the given ids into search groups, a single one with kmer_length and
+ * max_candidates unless adaptive is set (see kAdaptiveMaxLengths); empty groups are left out */
+void createSearchGroups(std::vector<SearchGroup>& dst, Chain** queries,
+    const std::vector<uint32_t>& ids, uint32_t kmer_length, uint32_t max_candidates,
+    bool adaptive) {
+
+    dst.clear();
+
+    if (!adaptive) {
+        dst.emplace_back(kmer_length, max_candidates);
+        dst.back().ids = ids;
+    } else {
+        for (uint32_t i = 0; i < kAdaptiveGroups; ++i) {
+            dst.emplace_back(kAdaptiveKmerLengths[i], std::max<uint32_t>(1,
+                (uint64_t) max_candidates * kAdaptiveCandidatesPercentages[i] / 100));
+        }
+        for (const auto& id: ids) {
+            uint32_t i = 0;
+            while (i + 1 < kAdaptiveGroups && (uint32_t) chainGetLength(queries[id]) >= kAdaptiveMaxLengths[i]) {
+                ++i;
+            }
+            dst[i].ids.emplace_back(id);
+        }
+    }
+
+    dst.erase(std::remove_if(dst.begin(), dst.end(), [](const SearchGroup& group) -> bool {
+        return group.ids.empty(); }), dst.end());
+}
+
+/* creates the query hash of each group leaving out the stop words of its k-mer length
+ * (none if stop_sets does not hold them) and resets its candidates */
+void initializeSearchGroups(std::vector<SearchGroup>& groups, Chain** queries, bool seg,
+    const std::map<uint32_t, std::vector<bool>>& stop_sets, uint32_t num_threads) {
+
+    const std::vector<bool> no_stop_words;
+
+    for (auto& it: groups) {
+        std::vector<Chain*> group_queries;
+        for (const auto& id: it.ids) {
+            group_queries.emplace_back(queries[id]);
+        }
+        uint32_t group_queries_length = group_queries.size();
+
+        auto stop_set = stop_sets.find(it.kmer_length);
+        it.query_hash = createHash(group_queries.data(), group_queries_length, 0,
+            group_queries_length, it.kmer_length, seg, stop_set != stop_sets.end() ?
+            stop_set->second : no_stop_words);
+        it.min_scores.assign(group_queries_length, 1000000.0);
+        it.candidates.assign(num_threads, std::vector<std::vector<Candidate>>(group_queries_length));
+    }
+}
+
+/* moves the merged candidates of each group query to dst[id] */
+void collectCandidates(std::vector<std::vector<Candidate>>& dst, std::vector<SearchGroup>& groups) {
+
+    for (auto& it: groups) {
+        for (uint32_t i = 0; i < it.ids.size(); ++i) {
+            dst[it.ids[i]].swap(it.candidates[0][i]);
+        }
+    }
+}
+
+/* marks the stop_words most frequent k-mers of database[0, database_length) in dst and
+ * reports the share of query k-mer hits in it they account for if log is set, returns a digest of the
+ * marked k-mers */
+uint64_t createQueryStopWords(std::vector<bool>& dst, Chain** database, uint32_t database_length,
+    Chain** queries, int32_t queries_length, uint32_t kmer_length, uint32_t stop_words, bool seg, bool log) {
+
+    std::vector<uint32_t> counts;
+    countKmers(counts, database, 0, database_length, kmer_length, seg);
+    createStopWords(dst, counts, stop_words);
+
+    // every occurrence of a query k-mer is a hit with each of its database occurrences
+    uint64_t hits = 0, removed_hits = 0, kmers = 0, removed_kmers = 0;
+    std::vector<uint32_t> query_kmers;
+    for (int32_t i = 0; i < queries_length; ++i) {
+        createKmerVector(query_kmers, queries[i], kmer_length);
+        if (seg) {
+            maskKmerVector(query_kmers, queries[i], kmer_length);
+        }
+        for (const auto& it: query_kmers) {
+            if (it == kMaskedKmer) {
+                continue;
+            }
+            ++kmers;
+            hits += counts[it];
+            if (dst[it]) {
+                ++removed_kmers;
+                removed_hits += counts[it];
+            }
+        }
+    }
+
+    if (log) {
+        fprintf(stderr, "** Stop words: %u most frequent k-mers of %u database sequences left out, "
+            "removing %.2f%% of query k-mers and %.2f%% of k-mer hits **\n", stop_words,
+            database_length, 100. * removed_kmers / std::max<uint64_t>(kmers, 1),
+            100. * removed_hits / std::max<uint64_t>(hits, 1));
+    }
+
+    uint64_t digest = kDigestSeed;
+    for (uint32_t i = 0; i < dst.size(); ++i) {
+        if (dst[i]) {
+            digest ^= i;
+            digest *= 1099511628211ULL;
+        }
+    }
+
+    return digest;
+}
+
+/* stop words of each k-mer length used by groups (see createQueryStopWords) counted in
+ * database[0, database_length), returns a digest of all of them */
+uint64_t createGroupStopWords(std::map<uint32_t, std::vector<bool>>& dst,
+    const std::vector<SearchGroup>& groups, Chain** database, uint32_t database_length,
+    Chain** queries, uint32_t stop_words, bool seg, bool log) {
+
+    dst.clear();
+
+    uint64_t digest = 0;
+    for (const auto& it: groups) {
+        if (dst.count(it.kmer_length) != 0) {
+            continue;
+        }
+
+        std::vector<Chain*> kmer_queries;
+        for (const auto& group: groups) {
+            if (group.kmer_length != it.kmer_length) {
+                continue;
+            }
+            for (const auto& id: group.ids) {
+                kmer_queries.emplace_back(queries[id]);
+            }
+        }
+
+        digest = digest * 1099511628211ULL ^ createQueryStopWords(dst[it.kmer_length], database,
+            database_length, kmer_queries.data(), kmer_queries.size(), it.kmer_length, stop_words,
+            seg, log);
+    }
+
+    return digest;
+}
+
+/* searches database[database_begin, database_end) for the queries of all groups with
+ * num_threads tasks, each database sequence is compared with every group, and merges the
+ * candidates of all tasks into candidates[0] of each group; low-complexity regions of
+ * database sequences are masked if masking is given */
+void searchDatabasePart(std::vector<SearchGroup>& groups, Chain** database,
+    uint32_t database_begin, uint32_t database_end, uint32_t num_threads, MaskingStats* masking,
+    const std::vector<uint32_t>* representatives, bool log, uint32_t part, float part_size) {
+
+    if (groups.empty()) {
+        return;
+    }
+
+    uint32_t database_split_size = (database_end - database_begin) / num_threads;
+    std::vector<uint32_t> database_splits(num_threads + 1, database_begin);
+    for (uint32_t i = 1; i < num_threads; ++i) {
+        database_splits[i] += i * database_split_size;
+    }
+    database_splits[num_threads] = database_end;
+
+    std::vector<ThreadPoolTask*> thread_tasks(num_threads, nullptr);
+
+    for (uint32_t i = 0; i < num_threads; ++i) {
+
+        auto thread_data = new ThreadSearchData(groups, i, database, database_splits[i],
+            database_splits[i + 1], masking, representatives, log && i == num_threads - 1,
+            part, part_size);
+
+        thread_tasks[i] = threadPoolSubmit(threadSearchDatabase, (void*) thread_data);
+    }
+
+    for (uint32_t i = 0; i < num_threads; ++i) {
+        threadPoolTaskWait(thread_tasks[i]);
+        threadPoolTaskDelete(thread_tasks[i]);
+    }
+
+    // merge candidates from all threads
+    for (auto& group: groups) {
+        auto& candidates = group.candidates;
+
+        for (uint32_t i = 0; i < group.ids.size(); ++i) {
             for (uint32_t j = 1; j < num_threads; ++j) {
                 if (candidates[j][i].empty()) {
                     continue;
@@ -141,56 +600,73 @@ uint64_t searchDatabase(std::vector<std::vector<uint32_t>>& dst,
 
             if (num_threads > 1) {
                 std::sort(candidates[0][i].begin(), candidates[0][i].end());
-                if (candidates[0][i].size() > max_candidates) {
+                if (candidates[0][i].size() > group.max_candidates) {
                     std::vector<Candidate> tmp(candidates[0][i].begin(),
-                        candidates[0][i].begin() + max_candidates);
+                        candidates[0][i].begin() + group.max_candidates);
                     candidates[0][i].swap(tmp);
                 }
             }
 
             if (!candidates[0][i].empty()) {
-                min_scores[i] = candidates[0][i].back().score;
+                group.min_scores[i] = candidates[0][i].back().score;
             }
         }
+    }
+}
 
-        databaseLog(part, part_size, 100);
-        ++part;
+void candidateBudgets(std::vector<uint32_t>& dst, const std::vector<SearchGroup>& groups,
+    uint32_t queries_length, uint32_t max_candidates) {
 
-        if (status == 0) {
-            break;
+    dst.assign(queries_length, max_candidates);
+    for (const auto& it: groups) {
+        for (const auto& id: it.ids) {
+            dst[id] = it.max_candidates;
         }
-
-        database_start = database_length;
     }
-    fprintf(stderr, "\n\n");
+}
 
-    fclose(handle);
-    deleteFastaChains(database, database_length);
+void candidatesToIndices(std::vector<std::vector<uint32_t>>& dst,
+    std::vector<std::vector<Candidate>>& candidates, uint32_t queries_length) {
 
     dst.clear();
     dst.resize(queries_length);
 
-    for (int32_t i = 0; i < queries_length; ++i) {
-        dst[i].reserve(candidates[0][i].size());
-        for (uint32_t j = 0; j < candidates[0][i].size(); ++j) {
-            dst[i].emplace_back(candidates[0][i][j].id);
+    for (uint32_t i = 0; i < queries_length; ++i) {
+        dst[i].reserve(candidates[i].size());
+        for (uint32_t j = 0; j < candidates[i].size(); ++j) {
+            dst[i].emplace_back(candidates[i][j].id);
         }
-        std::vector<Candidate>().swap(candidates[0][i]);
+        std::vector<Candidate>().swap(candidates[i]);
         std::sort(dst[i].begin(), dst[i].end());
     }
-
-    return database_cells;
 }
 
 void* threadSearchDatabase(void* params) {
 
     auto thread_data = (ThreadSearchData*) params;
+    auto& groups = thread_data->groups;
+
+    // groups with the same k-mer length share the k-mer vector of a database sequence
+    std::vector<uint32_t> kmer_lengths;
+    std::vector<uint32_t> group_vectors(groups.size());
+    for (uint32_t g = 0; g < groups.size(); ++g) {
+        auto it = std::find(kmer_lengths.begin(), kmer_lengths.end(), groups[g].kmer_length);
+        group_vectors[g] = it - kmer_lengths.begin();
+        if (it == kmer_lengths.end()) {
+            kmer_lengths.emplace_back(groups[g].kmer_length);
+        }
+    }
 
-    thread_data->candidates.resize(thread_data->queries_length);
+    std::vector<std::vector<uint32_t>> kmer_vectors(kmer_lengths.size());
+    std::vector<uint8_t> mask;
+    std::vector<std::vector<std::vector<int32_t>>> hits(groups.size());
+    std::vector<std::vector<float>> min_scores(groups.size());
+    for (uint32_t g = 0; g < groups.size(); ++g) {
+        hits[g].resize(groups[g].ids.size());
+        min_scores[g] = groups[g].min_scores;
+    }
 
-    std::vector<uint32_t> kmer_vector;
-    std::vector<std::vector<int32_t>> hits(thread_data->queries_length);
-    std::vector<float> min_scores(thread_data->min_scores);
+    uint64_t masked_cells = 0, masked_residues = 0, masking_time = 0;
 
     uint32_t log_counter = 0;
     uint32_t log_size = (thread_data->database_end - thread_data->database_begin) / (100. / log_step_percentage);
@@ -206,44 +682,88 @@ void* threadSearchDatabase(void* params) {
             }
         }
 
-        createKmerVector(kmer_vector, thread_data->database[i], thread_data->kmer_length);
+        if (thread_data->representatives != nullptr && i < thread_data->representatives->size() &&
+            (*thread_data->representatives)[i] != i) {
+            continue;
+        }
 
-        for (uint32_t j = 0; j < kmer_vector.size(); ++j) {
-            if (j != 0 && kmer_vector[j] == kmer_vector[j - 1]) {
-                continue;
-            }
+        Chain* chain = thread_data->database[i];
+        uint32_t chain_length = chainGetLength(chain);
+
+        // low-complexity regions are found once for all k-mer lengths
+        uint32_t masked = 0;
+        if (thread_data->masking != nullptr) {
+            uint64_t begin = timerNow();
+            masked = maskLowComplexity(mask, chainGetCodes(chain), chain_length);
+            masked_residues += masked;
+            masked_cells += chain_length;
+            masking_time += timerNow() - begin;
+        }
 
-            Hash::Iterator begin, end;
-            thread_data->query_hash->hits(begin, end, kmer_vector[j]);
-            for (; begin != end; ++begin) {
-                hits[begin->id].emplace_back(begin->position);
+        for (uint32_t v = 0; v < kmer_lengths.size(); ++v) {
+            createKmerVector(kmer_vectors[v], chain, kmer_lengths[v]);
+            if (masked != 0) {
+                uint64_t begin = timerNow();
+                maskKmerVector(kmer_vectors[v], mask, chain_length, kmer_lengths[v]);
+                masking_time += timerNow() - begin;
             }
         }
 
-        for (uint32_t j = 0; j < thread_data->queries_length; ++j) {
-            if (hits[j].empty()) {
-                continue;
-            }
+        for (uint32_t g = 0; g < groups.size(); ++g) {
 
-            float similartiy_score = longestIncreasingSubsequence(hits[j]) /
-                (float) chainGetLength(thread_data->database[i]);
+            auto& group = groups[g];
+            auto& candidates = group.candidates[thread_data->task];
+            auto& group_hits = hits[g];
+            auto& group_min_scores = min_scores[g];
+            const auto& kmer_vector = kmer_vectors[group_vectors[g]];
 
-            if (thread_data->candidates[j].size() < thread_data->max_candidates || similartiy_score > min_scores[j]) {
-                thread_data->candidates[j].emplace_back(similartiy_score, i);
-                min_scores[j] = std::min(min_scores[j], similartiy_score);
+            for (uint32_t j = 0; j < kmer_vector.size(); ++j) {
+                if ((j != 0 && kmer_vector[j] == kmer_vector[j - 1]) || kmer_vector[j] == kMaskedKmer) {
+                    continue;
+                }
+
+                Hash::Iterator begin, end;
+                group.query_hash->hits(begin, end, kmer_vector[j]);
+                for (; begin != end; ++begin) {
+                    group_hits[begin->id].emplace_back(begin->position);
+                }
             }
 
-            std::vector<int32_t>().swap(hits[j]);
+            for (uint32_t j = 0; j < group.ids.size(); ++j) {
+                if (group_hits[j].empty()) {
+                    continue;
+                }
+
+                float similartiy_score = longestIncreasingSubsequence(group_hits[j]) /
+                    (float) chain_length;
+
+                if (candidates[j].size() < group.max_candidates || similartiy_score > group_min_scores[j]) {
+                    candidates[j].emplace_back(similartiy_score, i);
+                    group_min_scores[j] = std::min(group_min_scores[j], similartiy_score);
+                }
+
+                std::vector<int32_t>().swap(group_hits[j]);
+            }
         }
     }
 
-    for (uint32_t i = 0; i < thread_data->queries_length; ++i) {
-        std::sort(thread_data->candidates[i].begin(), thread_data->candidates[i].end());
+    if (thread_data->masking != nullptr) {
+        thread_data->masking->cells += masked_cells;
+        thread_data->masking->residues += masked_residues;
+        thread_data->masking->time += masking_time;
+    }
+
+    for (auto& group: groups) {
+        auto& candidates = group.candidates[thread_data->task];
+
+        for (uint32_t i = 0; i < group.ids.size(); ++i) {
+            std::sort(candidates[i].begin(), candidates[i].end());
 
-        if (thread_data->candidates[i].size() > thread_data->max_candidates) {
-            std::vector<Candidate> tmp(thread_data->candidates[i].begin(),
-                thread_data->candidates[i].begin() + thread_data->max_candidates);
-            thread_data->candidates[i].swap(tmp);
+            if (candidates[i].size() > group.max_candidates) {
+                std::vector<Candidate> tmp(candidates[i].begin(),
+                    candidates[i].begin() + group.max_candidates);
+                candidates[i].swap(tmp);
+            }
         }
     }
 
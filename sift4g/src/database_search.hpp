@@ -11,9 +11,72 @@
 #include <stdint.h>
 #include <vector>
 #include <string>
+#include <map>
 
 #include "swsharp/swsharp.h"
 
+class SearchState;
+
+/*!
+ * @brief Database sequence with its similarity score to a query, candidates are
+ * ordered by descending score.
+ */
+class Candidate {
+public:
+    Candidate(float _score, int _id) :
+            score(_score), id(_id) {
+    }
+
+    bool operator<(const Candidate& other) const {
+        return this->score > other.score;
+    }
+
+    float score;
+    int32_t id;
+};
+
+/* adaptive search: queries shorter than kAdaptiveMaxLengths[i] residues (and not shorter
+than the previous bound) are searched with k-mers of length kAdaptiveKmerLengths[i] and
+kAdaptiveCandidatesPercentages[i] percent of max_candidates, short queries need short
+k-mers to find remote homologs while long ones share enough long k-mers with them */
+constexpr uint32_t kAdaptiveGroups = 3;
+constexpr uint32_t kAdaptiveMaxLengths[kAdaptiveGroups] = { 100, 300, UINT32_MAX };
+constexpr uint32_t kAdaptiveKmerLengths[kAdaptiveGroups] = { 3, 4, 5 };
+constexpr uint32_t kAdaptiveCandidatesPercentages[kAdaptiveGroups] = { 100, 100, 50 };
+
+/* if adaptive is set, queries are grouped by length with their own k-mer length and
+number of candidates instead of kmer_length and max_candidates (see kAdaptiveGroups), the
+database is still read once and each sequence is compared with every group;
+low-complexity regions of queries and database sequences are left out of k-mer matching
+if seg is set (see seg.hpp), as are the stop_words most frequent k-mers of the first
+database part read (of up to ~250MB) if it is not 0; only representatives of identical
+sequences are searched if representatives is not empty, dst then holds their members
+(see expandDatabaseClusters); if
+state is given, queries found in it are compared only with the sequences appended to
+the database since it was updated and their stored candidates are merged in (the whole
+database is searched if the previously searched sequences changed), stop words are then
+counted only in the previously searched sequences of the first part, the state is
+updated with the candidates of all queries afterwards (see search_state.hpp) */
 uint64_t searchDatabase(std::vector<std::vector<uint32_t>>& dst,
     const std::string& database_path, Chain** queries, int32_t queries_length,
-    uint32_t kmer_length, uint32_t max_candidates, uint32_t num_threads);
+    uint32_t kmer_length, uint32_t max_candidates, uint32_t num_threads, bool seg,
+    uint32_t stop_words, bool adaptive, const std::vector<uint32_t>& representatives,
+    SearchState* state = nullptr);
+
+/* k-mer lengths searchDatabase uses with the given options */
+std::vector<uint32_t> searchKmerLengths(uint32_t kmer_length, bool adaptive);
+
+/* marks the stop_words most frequent k-mers of each of kmer_lengths missing from dst,
+counted in the whole database kept in memory */
+void createStopWordSets(std::map<uint32_t, std::vector<bool>>& dst, Chain** database,
+    int32_t database_length, const std::vector<uint32_t>& kmer_lengths, uint32_t stop_words,
+    bool seg);
+
+/* searches a database kept in memory without logging, its chains are not deleted;
+stop_sets holds the stop words of each k-mer length (see createStopWordSets), k-mer
+lengths missing from it are searched without stop words */
+uint64_t searchDatabase(std::vector<std::vector<uint32_t>>& dst,
+    Chain** database, int32_t database_length, Chain** queries, int32_t queries_length,
+    uint32_t kmer_length, uint32_t max_candidates, uint32_t num_threads, bool seg,
+    const std::map<uint32_t, std::vector<bool>>& stop_sets, bool adaptive,
+    const std::vector<uint32_t>& representatives);
@@ -0,0 +1,146 @@
+/*!
+ * @file database_stats.cpp
+ *
+ * @brief Database statistics source file
+ *
+ * @author: rvaser
+ */
+
+#include <stdio.h>
+#include <sstream>
+
+#include "utils.hpp"
+#include "database_stats.hpp"
+
+#include "swsharp/swsharp.h"
+
+constexpr uint32_t database_chunk = 1000000000; /* ~1GB */
+
+/* file layout (text):
+ *     kStatsHeader
+ *     fingerprint of the database file (two lines)
+ *     sequences <number>
+ *     cells <number>
+ *     histogram <count of each bucket> */
+constexpr char kStatsHeader[] = "sift4g database statistics 1";
+
+std::string databaseStatsPath(const std::string& database_path) {
+    return database_path + ".stats";
+}
+
+void createDatabaseStats(DatabaseStats& dst, const std::string& database_path) {
+
+    fprintf(stderr, "** Reading database **\n");
+
+    dst.sequences = 0;
+    dst.cells = 0;
+    dst.histogram.clear();
+
+    Chain** database = nullptr;
+    int database_length = 0;
+    int database_start = 0;
+
+    FILE* handle = nullptr;
+    int serialized = 0;
+    readFastaChainsPartInit(&database, &database_length, &handle, &serialized,
+        database_path.c_str());
+
+    uint32_t part = 1;
+    float part_size = database_chunk / (float) 1000000000;
+
+    while (true) {
+
+        int status = readFastaChainsPart(&database, &database_length, handle,
+            serialized, database_chunk);
+
+        databaseLog(part, part_size, 0);
+
+        for (int i = database_start; i < database_length; ++i) {
+            uint64_t length = chainGetLength(database[i]);
+
+            uint32_t bucket = 0;
+            while ((length + 1) >> (bucket + 1) != 0) {
+                ++bucket;
+            }
+            if (dst.histogram.size() <= bucket) {
+                dst.histogram.resize(bucket + 1, 0);
+            }
+            ++dst.histogram[bucket];
+
+            ++dst.sequences;
+            dst.cells += length;
+
+            chainDelete(database[i]);
+            database[i] = nullptr;
+        }
+
+        databaseLog(part, part_size, 100);
+        ++part;
+
+        if (status == 0) {
+            break;
+        }
+
+        database_start = database_length;
+    }
+    fprintf(stderr, "\n\n");
+
+    fclose(handle);
+    deleteFastaChains(database, database_length);
+
+    std::string data = std::string(kStatsHeader) + "\n" + fileFingerprint(database_path) +
+        "\nsequences " + std::to_string((unsigned long long) dst.sequences) +
+        "\ncells " + std::to_string((unsigned long long) dst.cells) + "\nhistogram";
+    for (const auto& it: dst.histogram) {
+        data += " " + std::to_string((unsigned long long) it);
+    }
+    data += "\n";
+
+    replaceFile(databaseStatsPath(database_path), data);
+}
+
+bool readDatabaseStats(DatabaseStats& dst, const std::string& database_path) {
+
+    std::string data;
+    if (!readFile(databaseStatsPath(database_path), data)) {
+        return false;
+    }
+
+    std::string header = std::string(kStatsHeader) + "\n" + fileFingerprint(database_path) + "\n";
+    if (data.compare(0, header.size(), header) != 0) {
+        return false;
+    }
+
+    std::istringstream in(data.substr(header.size()));
+    std::string sequences_key, cells_key, histogram_key;
+    unsigned long long sequences = 0, cells = 0;
+    if (!(in >> sequences_key >> sequences >> cells_key >> cells >> histogram_key) ||
+        sequences_key != "sequences" || cells_key != "cells" || histogram_key != "histogram") {
+        return false;
+    }
+
+    dst.sequences = sequences;
+    dst.cells = cells;
+    dst.histogram.clear();
+
+    unsigned long long count;
+    while (in >> count) {
+        dst.histogram.emplace_back(count);
+    }
+
+    return true;
+}
+
+void printDatabaseStats(const DatabaseStats& stats) {
+
+    fprintf(stdout, "sequences\t%llu\ncells\t%llu\n", (unsigned long long) stats.sequences,
+        (unsigned long long) stats.cells);
+
+    for (uint32_t i = 0; i < stats.histogram.size(); ++i) {
+        if (stats.histogram[i] == 0) {
+            continue;
+        }
+        fprintf(stdout, "length %llu-%llu\t%llu\n", (1ULL << i) - 1, (1ULL << (i + 1)) - 2,
+            (unsigned long long) stats.histogram[i]);
+    }
+}
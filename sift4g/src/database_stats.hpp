@@ -0,0 +1,36 @@
+/*!
+ * @file database_stats.hpp
+ *
+ * @brief Database statistics header file
+ *
+ * @author: rvaser
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+/*!
+ * @brief Size of a database file, histogram[i] counts sequences with lengths in
+ * [2^i - 1, 2^(i+1) - 1) (the first bucket holds empty sequences).
+ */
+class DatabaseStats {
+public:
+    uint64_t sequences;
+    uint64_t cells;
+    std::vector<uint64_t> histogram;
+};
+
+/* path of the statistics file kept next to the database file */
+std::string databaseStatsPath(const std::string& database_path);
+
+/* reads the database once and writes its statistics file */
+void createDatabaseStats(DatabaseStats& dst, const std::string& database_path);
+
+/* returns false if the statistics file is missing or was created for a different
+database file (by path, size and modification time) */
+bool readDatabaseStats(DatabaseStats& dst, const std::string& database_path);
+
+void printDatabaseStats(const DatabaseStats& stats);
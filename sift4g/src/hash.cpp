@@ -7,8 +7,10 @@
  */
 
 #include <queue>
+#include <algorithm>
 
 #include "hash.hpp"
+#include "seg.hpp"
 #include "utils.hpp"
 
 #include "swsharp/swsharp.h"
@@ -43,26 +45,114 @@ void createKmerVector(std::vector<uint32_t>& dst, Chain* chain, uint32_t kmer_le
     }
 }
 
+uint32_t maskKmerVector(std::vector<uint32_t>& dst, Chain* chain, uint32_t kmer_length) {
+
+    static thread_local std::vector<uint8_t> mask;
+
+    uint32_t chain_length = chainGetLength(chain);
+    uint32_t masked = maskLowComplexity(mask, chainGetCodes(chain), chain_length);
+    if (masked != 0) {
+        maskKmerVector(dst, mask, chain_length, kmer_length);
+    }
+
+    return masked;
+}
+
+void maskKmerVector(std::vector<uint32_t>& dst, const std::vector<uint8_t>& mask,
+    uint32_t chain_length, uint32_t kmer_length) {
+
+    if (dst.empty()) {
+        return;
+    }
+
+    // number of masked residues among the last kmer_length ones
+    uint32_t window = 0;
+    for (uint32_t i = 0; i < chain_length; ++i) {
+        window += mask[i];
+        if (i >= kmer_length) {
+            window -= mask[i - kmer_length];
+        }
+        if (i + 1 >= kmer_length && window != 0) {
+            dst[i + 1 - kmer_length] = kMaskedKmer;
+        }
+    }
+}
+
+void countKmers(std::vector<uint32_t>& dst, Chain** chains, uint32_t begin, uint32_t end,
+    uint32_t kmer_length, bool seg) {
+
+    dst.assign(kNumDiffKmers[kmer_length], 0);
+
+    std::vector<uint32_t> chain_kmers;
+    for (uint32_t i = begin; i < end; ++i) {
+
+        createKmerVector(chain_kmers, chains[i], kmer_length);
+        if (seg) {
+            maskKmerVector(chain_kmers, chains[i], kmer_length);
+        }
+
+        for (const auto& it: chain_kmers) {
+            if (it != kMaskedKmer) {
+                ++dst[it];
+            }
+        }
+    }
+}
+
+void createStopWords(std::vector<bool>& dst, const std::vector<uint32_t>& counts, uint32_t length) {
+
+    dst.assign(counts.size(), false);
+
+    std::vector<uint32_t> kmers;
+    for (uint32_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] != 0) {
+            kmers.emplace_back(i);
+        }
+    }
+
+    // ties are broken by the k-mer so that equal counts give equal stop words
+    auto is_more_frequent = [&counts](uint32_t a, uint32_t b) -> bool {
+        return counts[a] != counts[b] ? counts[a] > counts[b] : a < b;
+    };
+
+    if (kmers.size() > length) {
+        std::nth_element(kmers.begin(), kmers.begin() + length, kmers.end(), is_more_frequent);
+        kmers.resize(length);
+    }
+
+    for (const auto& it: kmers) {
+        dst[it] = true;
+    }
+}
+
 std::unique_ptr<Hash> createHash(Chain** chains, uint32_t chains_length,
-    uint32_t start, uint32_t length, uint32_t kmer_length) {
+    uint32_t start, uint32_t length, uint32_t kmer_length, bool seg,
+    const std::vector<bool>& stop_words) {
 
     ASSERT(chains_length, "zero chains passed to hash");
     ASSERT(start < chains_length && start + length <= chains_length, "invalid chain interval");
     ASSERT(kmer_length && kmer_length < 6, "invalid kmer_length");
 
-    return std::unique_ptr<Hash>(new Hash(chains, chains_length, start, length, kmer_length));
+    return std::unique_ptr<Hash>(new Hash(chains, chains_length, start, length, kmer_length,
+        seg, stop_words));
 }
 
 Hash::Hash(Chain** chains, uint32_t chains_length, uint32_t start, uint32_t length,
-    uint32_t kmer_length)
-        : starts_(kNumDiffKmers[kmer_length], 0) {
+    uint32_t kmer_length, bool seg, const std::vector<bool>& stop_words)
+        : starts_(kNumDiffKmers[kmer_length], 0), masked_residues_(0) {
 
     std::vector<uint32_t> chain_kmers;
     for (uint32_t i = start; i < start + length; ++i) {
 
         createKmerVector(chain_kmers, chains[i], kmer_length);
+        if (seg) {
+            masked_residues_ += maskKmerVector(chain_kmers, chains[i], kmer_length);
+        }
 
         for (uint32_t j = 0; j < chain_kmers.size(); ++j) {
+            if (chain_kmers[j] == kMaskedKmer || (!stop_words.empty() && stop_words[chain_kmers[j]])) {
+                continue;
+            }
             ++starts_[chain_kmers[j] + 1];
         }
     }
@@ -77,8 +167,14 @@ Hash::Hash(Chain** chains, uint32_t chains_length, uint32_t start, uint32_t leng
     for (uint32_t i = start; i < start + length; ++i) {
 
         createKmerVector(chain_kmers, chains[i], kmer_length);
+        if (seg) {
+            maskKmerVector(chain_kmers, chains[i], kmer_length);
+        }
 
         for (uint32_t j = 0; j < chain_kmers.size(); ++j) {
+            if (chain_kmers[j] == kMaskedKmer || (!stop_words.empty() && stop_words[chain_kmers[j]])) {
+                continue;
+            }
             hits_[tmp[chain_kmers[j]]++] = Hit(i - start, j);
         }
     }
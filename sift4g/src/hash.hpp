@@ -14,8 +14,30 @@
 
 struct Chain;
 
+/* k-mers replaced with kMaskedKmer are skipped by hashing and database search */
+constexpr uint32_t kMaskedKmer = UINT32_MAX;
+
 void createKmerVector(std::vector<uint32_t>& dst, Chain* chain, uint32_t kmer_length);
 
+/* replaces k-mers of dst (created with createKmerVector) overlapping low-complexity
+regions of the chain (see seg.hpp) with kMaskedKmer, returns the number of masked
+residues */
+uint32_t maskKmerVector(std::vector<uint32_t>& dst, Chain* chain, uint32_t kmer_length);
+
+/* replaces k-mers of dst overlapping residues set in mask (created with maskLowComplexity
+for the same chain) with kMaskedKmer, the mask can be shared by k-mer vectors of
+different lengths */
+void maskKmerVector(std::vector<uint32_t>& dst, const std::vector<uint8_t>& mask,
+    uint32_t chain_length, uint32_t kmer_length);
+
+/* occurrences of each k-mer in chains[begin, end), k-mers of low-complexity regions are
+not counted if seg is set */
+void countKmers(std::vector<uint32_t>& dst, Chain** chains, uint32_t begin, uint32_t end,
+    uint32_t kmer_length, bool seg);
+
+/* marks the length most frequent k-mers of counts (see countKmers) */
+void createStopWords(std::vector<bool>& dst, const std::vector<uint32_t>& counts, uint32_t length);
+
 class Hit {
 public:
 
@@ -30,8 +52,11 @@ public:
 
 class Hash;
 
+/* k-mers of low-complexity regions are left out if seg is set, as are k-mers marked in
+stop_words (empty or created with createStopWords) */
 std::unique_ptr<Hash> createHash(Chain** chains, uint32_t chains_length,
-    uint32_t start, uint32_t length, uint32_t kmer_length);
+    uint32_t start, uint32_t length, uint32_t kmer_length, bool seg,
+    const std::vector<bool>& stop_words);
 
 class Hash {
 public:
@@ -41,17 +66,24 @@ public:
     using Iterator = std::vector<Hit>::iterator;
     void hits(Iterator& start, Iterator& end, uint32_t key);
 
+    /* residues of hashed chains in low-complexity regions */
+    uint64_t maskedResidues() const {
+        return masked_residues_;
+    }
+
     friend std::unique_ptr<Hash> createHash(Chain** chains, uint32_t chains_length,
-        uint32_t start, uint32_t length, uint32_t kmer_length);
+        uint32_t start, uint32_t length, uint32_t kmer_length, bool seg,
+        const std::vector<bool>& stop_words);
 
 private:
 
     Hash(Chain** chains, uint32_t chains_length, uint32_t start, uint32_t length,
-        uint32_t kmer_length);
+        uint32_t kmer_length, bool seg, const std::vector<bool>& stop_words);
 
     Hash(const Hash&) = delete;
     const Hash& operator=(const Hash&) = delete;
 
     std::vector<size_t> starts_;
     std::vector<Hit> hits_;
+    uint64_t masked_residues_;
 };
@@ -2,12 +2,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 
 #include "utils.hpp"
 #include "database_search.hpp"
 #include "database_alignment.hpp"
 #include "select_alignments.hpp"
 #include "sift_prediction.hpp"
+#include "output_archive.hpp"
+#include "score_store.hpp"
+#include "checkpoint.hpp"
+#include "search_state.hpp"
+#include "database_stats.hpp"
+#include "database_clusters.hpp"
+#include "server.hpp"
 
 #include "swsharp/evalue.h"
 #include "swsharp/swsharp.h"
@@ -37,6 +45,24 @@ static struct option options[] = {
     {"max-aligns", required_argument, 0, 'M'},
     {"algorithm", required_argument, 0, 'A'},
     {"threads", required_argument, 0, 't'},
+    {"timings", no_argument, 0, 'P'},
+    {"archive", no_argument, 0, 'a'},
+    {"extract", required_argument, 0, 'x'},
+    {"list", no_argument, 0, 'l'},
+    {"score-store", no_argument, 0, 'B'},
+    {"lookup", required_argument, 0, 'L'},
+    {"cache", required_argument, 0, 'R'},
+    {"checkpoint", required_argument, 0, 'W'},
+    {"no-checkpoint", no_argument, 0, 'N'},
+    {"serve", required_argument, 0, 'V'},
+    {"search-state", required_argument, 0, 'U'},
+    {"database-stats", no_argument, 0, 'Z'},
+    {"database-cells", required_argument, 0, 'Y'},
+    {"seg", no_argument, 0, 'G'},
+    {"stop-words", required_argument, 0, 'O'},
+    {"database-clusters", no_argument, 0, 'K'},
+    {"collapse-duplicates", no_argument, 0, 'D'},
+    {"adaptive-search", no_argument, 0, 'J'},
     {"help", no_argument, 0, 'h'},
     {0, 0, 0, 0}
 };
@@ -56,6 +82,7 @@ static CharInt algorithms[] = {
 };
 
 static void getCudaCards(int** cards, int* cardsLen, char* optarg);
+static void getList(std::vector<std::string>& dst, char* optarg);
 static int getOutFormat(char* optarg);
 static int getAlgorithm(char* optarg);
 static void help();
@@ -84,12 +111,43 @@ int main(int argc, char* argv[]) {
 
     int32_t algorithm = SW_ALIGN;
 
-    float median_threshold = 2.75;
+    std::vector<float> median_thresholds = { 2.75 };
     std::string subst_path = "";
-    int32_t sequence_identity = 100;
+    std::vector<int32_t> sequence_identities = { 100 };
 
     uint32_t num_threads = 8;
 
+    bool print_timings = false;
+
+    bool archive = false;
+    std::string extract_path = "";
+    bool list_archive = false;
+
+    bool score_store = false;
+    std::string lookup_path = "";
+
+    std::string cache_path = "";
+
+    std::string checkpoint_path = "";
+    bool use_checkpoint = true;
+
+    std::string serve_path = "";
+
+    std::string search_state_path = "";
+
+    bool database_stats = false;
+    uint64_t database_cells = 0;
+
+    bool seg = false;
+    uint32_t stop_words = 0;
+
+    bool database_clusters = false;
+    bool collapse_duplicates = false;
+
+    bool adaptive_search = false;
+
+    std::vector<std::string> values;
+
     while (1) {
 
         char argument = getopt_long(argc, argv, "q:d:g:e:t:h", options, NULL);
@@ -112,7 +170,11 @@ int main(int argc, char* argv[]) {
             max_candidates = atoi(optarg);
             break;
         case 'T':
-            median_threshold = atof(optarg);
+            median_thresholds.clear();
+            getList(values, optarg);
+            for (const auto& it: values) {
+                median_thresholds.emplace_back(atof(it.c_str()));
+            }
             break;
         case 'g':
             gap_open = atoi(optarg);
@@ -133,7 +195,11 @@ int main(int argc, char* argv[]) {
             sub_results = true;
             break;
         case 'I':
-            sequence_identity = atoi(optarg);
+            sequence_identities.clear();
+            getList(values, optarg);
+            for (const auto& it: values) {
+                sequence_identities.emplace_back(atoi(it.c_str()));
+            }
             break;
         case 'f':
             out_format = getOutFormat(optarg);
@@ -153,6 +219,61 @@ int main(int argc, char* argv[]) {
         case 't':
             num_threads = atoi(optarg);
             break;
+        case 'P':
+            print_timings = true;
+            break;
+        case 'a':
+            archive = true;
+            break;
+        case 'x':
+            extract_path = optarg;
+            break;
+        case 'l':
+            list_archive = true;
+            break;
+        case 'B':
+            score_store = true;
+            break;
+        case 'L':
+            lookup_path = optarg;
+            break;
+        case 'R':
+            cache_path = optarg;
+            break;
+        case 'W':
+            checkpoint_path = optarg;
+            break;
+        case 'N':
+            use_checkpoint = false;
+            break;
+        case 'V':
+            serve_path = optarg;
+            break;
+        case 'U':
+            search_state_path = optarg;
+            break;
+        case 'Z':
+            database_stats = true;
+            break;
+        case 'Y':
+            database_cells = strtoull(optarg, nullptr, 10);
+            ASSERT(database_cells > 0, "invalid database cells number");
+            break;
+        case 'G':
+            seg = true;
+            break;
+        case 'O':
+            stop_words = atoi(optarg);
+            break;
+        case 'K':
+            database_clusters = true;
+            break;
+        case 'D':
+            collapse_duplicates = true;
+            break;
+        case 'J':
+            adaptive_search = true;
+            break;
         case 'h':
         default:
             help();
@@ -160,8 +281,58 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    ASSERT(!query_path.empty(), "missing option -q (query file)");
-    ASSERT(isExtantPath(query_path.c_str()) == 1, "invalid query file path '%s'", query_path.c_str());
+    if (!extract_path.empty()) {
+        ASSERT(isExtantPath(extract_path.c_str()) == 1, "invalid archive file path '%s'", extract_path.c_str());
+
+        if (list_archive) {
+            listArchive(extract_path);
+            return 0;
+        }
+
+        if (!out_path.empty()) {
+            ASSERT(isExtantPath(out_path.c_str()) == 0, "invalid out directory path '%s'", out_path.c_str());
+        }
+
+        std::vector<std::string> names(argv + optind, argv + argc);
+        extractArchive(extract_path, out_path, names);
+        return 0;
+    }
+
+    if (!lookup_path.empty()) {
+        ASSERT(isExtantPath(lookup_path.c_str()) == 1, "invalid score store file path '%s'", lookup_path.c_str());
+
+        std::vector<std::string> triplets(argv + optind, argv + argc);
+        lookupScoreStore(lookup_path, triplets);
+        return 0;
+    }
+
+    if (database_stats) {
+        ASSERT(!database_path.empty(), "missing option -d (database file)");
+        ASSERT(isExtantPath(database_path.c_str()) == 1, "invalid database file path '%s'", database_path.c_str());
+
+        DatabaseStats stats;
+        createDatabaseStats(stats, database_path);
+        printDatabaseStats(stats);
+        return 0;
+    }
+
+    if (database_clusters) {
+        ASSERT(!database_path.empty(), "missing option -d (database file)");
+        ASSERT(isExtantPath(database_path.c_str()) == 1, "invalid database file path '%s'", database_path.c_str());
+
+        std::vector<uint32_t> representatives;
+        createDatabaseClusters(representatives, database_path);
+        fprintf(stdout, "sequences\t%zu\nrepresentatives\t%u\n", representatives.size(),
+            countRepresentatives(representatives));
+        return 0;
+    }
+
+    if (serve_path.empty()) {
+        ASSERT(!query_path.empty(), "missing option -q (query file)");
+        ASSERT(isExtantPath(query_path.c_str()) == 1, "invalid query file path '%s'", query_path.c_str());
+    } else {
+        ASSERT(isExtantPath(serve_path.c_str()) == 0, "invalid spool directory path '%s'", serve_path.c_str());
+    }
 
     ASSERT(!database_path.empty(), "missing option -d (database file)");
     ASSERT(isExtantPath(database_path.c_str()) == 1, "invalid database file path '%s'", database_path.c_str());
@@ -187,10 +358,43 @@ int main(int argc, char* argv[]) {
 
     threadPoolInitialize(num_threads);
 
+    if (!serve_path.empty()) {
+        ServerOptions server_options;
+        server_options.kmer_length = kmer_length;
+        server_options.max_candidates = max_candidates;
+        server_options.gap_open = gap_open;
+        server_options.gap_extend = gap_extend;
+        server_options.matrix = matrix;
+        server_options.max_evalue = max_evalue;
+        server_options.max_alignments = max_alignments;
+        server_options.algorithm = algorithm;
+        server_options.cards = cards;
+        server_options.cards_length = cards_length;
+        server_options.median_thresholds = median_thresholds;
+        server_options.sequence_identities = sequence_identities;
+        server_options.sub_results = sub_results;
+        server_options.out_format = out_format;
+        server_options.archive = archive;
+        server_options.score_store = score_store;
+        server_options.num_threads = num_threads;
+        server_options.database_cells = database_cells;
+        server_options.seg = seg;
+        server_options.stop_words = stop_words;
+        server_options.collapse_duplicates = collapse_duplicates;
+        server_options.adaptive_search = adaptive_search;
+
+        serve(serve_path, database_path, server_options);
+
+        threadPoolTerminate();
+        free(cards);
+        return 0;
+    }
+
     Chain** queries = nullptr;
     int32_t queries_length = 0;
     readFastaChains(&queries, &queries_length, query_path.c_str());
-    checkData(queries, queries_length, subst_path);
+    std::vector<std::vector<Substitution>> substitutions;
+    checkData(queries, queries_length, subst_path, substitutions);
 
     if (queries_length == 0) {
         fprintf(stderr, "** EXITING! No valid queries to process. **\n");
@@ -200,48 +404,277 @@ int main(int argc, char* argv[]) {
         return -1;
     }
 
-    std::vector<std::vector<uint32_t>> indices;
-    uint64_t cells = searchDatabase(indices, database_path, queries, queries_length,
-        kmer_length, max_candidates, num_threads);
+    // every option which changes the selected alignments
+    char parameters[1024];
+    snprintf(parameters, sizeof(parameters), "kmer_length=%u max_candidates=%u gap_open=%d "
+        "gap_extend=%d matrix=%s evalue=%.17g max_aligns=%u algorithm=%d",
+        kmer_length, max_candidates, gap_open, gap_extend, matrix, max_evalue, max_alignments,
+        algorithm);
+    if (database_cells != 0) {
+        snprintf(parameters + strlen(parameters), sizeof(parameters) - strlen(parameters),
+            " database_cells=%llu", (unsigned long long) database_cells);
+    }
+    if (seg) {
+        snprintf(parameters + strlen(parameters), sizeof(parameters) - strlen(parameters), " seg=1");
+    }
+    if (stop_words != 0) {
+        snprintf(parameters + strlen(parameters), sizeof(parameters) - strlen(parameters),
+            " stop_words=%u", stop_words);
+    }
+    if (collapse_duplicates) {
+        snprintf(parameters + strlen(parameters), sizeof(parameters) - strlen(parameters),
+            " collapse_duplicates=1");
+    }
+    if (adaptive_search) {
+        snprintf(parameters + strlen(parameters), sizeof(parameters) - strlen(parameters),
+            " adaptive_search=1");
+    }
 
-    Scorer* scorer = nullptr;
-    scorerCreateMatrix(&scorer, matrix, gap_open, gap_extend);
+    std::unique_ptr<Checkpoint> checkpoint = nullptr;
+    if (use_checkpoint) {
+        if (checkpoint_path.empty()) {
+            char* default_path = createFileName("sift4g_checkpoint", out_path, "");
+            checkpoint_path = default_path;
+            delete[] default_path;
+        }
 
-    EValueParams* evalue_params = createEValueParams(cells, scorer);
+        // input files and every other option which changes the outputs
+        std::string run = fileFingerprint(query_path) + "\n" + fileFingerprint(database_path) +
+            "\n" + parameters + "\nmedian_thresholds=";
+        for (const auto& it: median_thresholds) {
+            char threshold[32];
+            snprintf(threshold, sizeof(threshold), "%.9g,", it);
+            run += threshold;
+        }
+        run += " seq_ids=";
+        for (const auto& it: sequence_identities) {
+            run += std::to_string(it) + ",";
+        }
+        run += "\nout=" + out_path + "\nsubst=" + subst_path + "\nsub_results=" +
+            std::to_string(sub_results) + " outfmt=" + std::to_string(out_format) + " archive=" +
+            std::to_string(archive) + " score_store=" + std::to_string(score_store) + "\n";
+
+        checkpoint = createCheckpoint(checkpoint_path, run);
+    }
+
+    // queries with identical sequences are searched, aligned and scored once
+    std::vector<std::vector<uint32_t>> query_groups;
+    groupIdenticalQueries(query_groups, queries, queries_length);
+
+    int32_t groups_length = query_groups.size();
+    uint32_t settings_length = median_thresholds.size() * sequence_identities.size();
+
+    // groups completed before the run was interrupted are skipped
+    if (checkpoint != nullptr && checkpoint->isResumed()) {
+        uint32_t j = 0;
+        for (uint32_t i = 0; i < query_groups.size(); ++i) {
+            uint32_t query_index = query_groups[i].front();
+            if (!checkpoint->isCompleted(query_index, queries[query_index], settings_length)) {
+                query_groups[j++].swap(query_groups[i]);
+            }
+        }
+        query_groups.resize(j);
+    }
+
+    int32_t unique_queries_length = query_groups.size();
+    std::vector<Chain*> unique_queries(unique_queries_length);
+    for (int32_t i = 0; i < unique_queries_length; ++i) {
+        unique_queries[i] = queries[query_groups[i].front()];
+    }
 
-    DbAlignment*** alignments = nullptr;
-    int* alignments_lenghts = nullptr;
+    if (groups_length < queries_length) {
+        fprintf(stderr, "** Found %d unique sequences among %d queries **\n\n",
+            groups_length, queries_length);
+    }
+
+    std::unique_ptr<AlignmentCache> cache = nullptr;
+    if (!cache_path.empty()) {
+        cache = createAlignmentCache(cache_path, database_path, parameters);
+    }
+
+    // queries found in the cache are neither searched nor aligned
+    std::vector<bool> cached_groups(unique_queries_length, false);
+    std::vector<uint32_t> aligned_groups;
+    for (int32_t i = 0; i < unique_queries_length; ++i) {
+        bool is_cached = cache != nullptr;
+        for (const auto& it: median_thresholds) {
+            is_cached = is_cached && cache->contains(unique_queries[i], it);
+        }
+        if (is_cached) {
+            cached_groups[i] = true;
+        } else {
+            aligned_groups.emplace_back(i);
+        }
+    }
+
+    if (checkpoint != nullptr && checkpoint->isResumed()) {
+        fprintf(stderr, "** Resuming from checkpoint '%s': %d of %d sequences completed **\n\n",
+            checkpoint->path().c_str(), groups_length - unique_queries_length, groups_length);
+    }
+    if (!cache_path.empty()) {
+        fprintf(stderr, "** Found %d of %d sequences in cache '%s' **\n\n",
+            unique_queries_length - (int32_t) aligned_groups.size(), unique_queries_length,
+            cache_path.c_str());
+    }
+
+    std::unique_ptr<QueryTimings> timings = print_timings ? createQueryTimings(queries_length) : nullptr;
+
+    // indexed by group, groups found in the cache have no alignments
+    DbAlignment*** alignments = (DbAlignment***) calloc(unique_queries_length, sizeof(DbAlignment**));
+    int* alignments_lenghts = (int*) calloc(unique_queries_length, sizeof(int));
 
     Chain** database = nullptr;
     int32_t database_length = 0;
 
-    alignDatabase(&alignments, &alignments_lenghts, &database, &database_length,
-        database_path, queries, queries_length, indices, algorithm, evalue_params,
-        max_evalue, max_alignments, scorer, cards, cards_length);
+    // searches and aligns groups, siftPredictions calls it again for groups whose cache
+    // entry changed after it was found; such groups are searched without the checkpoint
+    // and the search state of the run
+    bool is_first_search = true;
+    auto align_groups = [&](const std::vector<uint32_t>& groups) -> void {
+
+        int32_t aligned_queries_length = groups.size();
+        if (aligned_queries_length == 0) {
+            return;
+        }
+
+        std::vector<Chain*> aligned_queries(aligned_queries_length);
+        std::vector<uint32_t> aligned_query_indices(aligned_queries_length);
+        for (int32_t i = 0; i < aligned_queries_length; ++i) {
+            aligned_queries[i] = unique_queries[groups[i]];
+            aligned_query_indices[i] = query_groups[groups[i]].front();
+        }
+
+        // alignments of earlier groups are already deleted by siftPredictions
+        if (database != nullptr) {
+            deleteFastaChains(database, database_length);
+            database = nullptr;
+        }
+
+        DbAlignment*** aligned = nullptr;
+        int* aligned_lengths = nullptr;
+
+        std::vector<std::vector<uint32_t>> indices;
+        uint64_t cells = 0;
+
+        // e-value statistics are set up before the search if the database size is known
+        if (database_cells == 0) {
+            DatabaseStats stats;
+            if (readDatabaseStats(stats, database_path)) {
+                fprintf(stderr, "** Using database size from '%s' **\n\n",
+                    databaseStatsPath(database_path).c_str());
+                database_cells = stats.cells;
+            }
+        }
+
+        Scorer* scorer = nullptr;
+        scorerCreateMatrix(&scorer, matrix, gap_open, gap_extend);
+
+        EValueParams* evalue_params = nullptr;
+        if (database_cells != 0) {
+            evalue_params = createEValueParams(database_cells, scorer);
+        }
+
+        if (!is_first_search || checkpoint == nullptr ||
+            !checkpoint->loadSearch(indices, cells, aligned_query_indices)) {
+            std::unique_ptr<SearchState> search_state = nullptr;
+            if (is_first_search && !search_state_path.empty()) {
+                // every option which changes the candidates
+                char search_parameters[256];
+                snprintf(search_parameters, sizeof(search_parameters),
+                    "kmer_length=%u max_candidates=%u seg=%d stop_words=%u "
+                    "collapse_duplicates=%d adaptive_search=%d", kmer_length, max_candidates,
+                    seg, stop_words, collapse_duplicates, adaptive_search);
+                search_state = createSearchState(search_state_path, search_parameters);
+            }
+
+            std::vector<uint32_t> representatives;
+            if (collapse_duplicates) {
+                if (readDatabaseClusters(representatives, database_path)) {
+                    fprintf(stderr, "** Using identical sequences from '%s' **\n",
+                        databaseClustersPath(database_path).c_str());
+                } else {
+                    createDatabaseClusters(representatives, database_path);
+                }
+                fprintf(stderr, "** Searching %u representatives of %zu database sequences **\n\n",
+                    countRepresentatives(representatives), representatives.size());
+            }
+
+            cells = searchDatabase(indices, database_path, aligned_queries.data(),
+                aligned_queries_length, kmer_length, max_candidates, num_threads, seg,
+                stop_words, adaptive_search, representatives, search_state.get());
+
+            if (search_state != nullptr) {
+                search_state->store();
+            }
+            if (is_first_search && checkpoint != nullptr) {
+                checkpoint->storeSearch(indices, cells, aligned_query_indices);
+            }
+        }
+
+        if (evalue_params == nullptr) {
+            evalue_params = createEValueParams(cells, scorer);
+        }
 
-    deleteEValueParams(evalue_params);
-    scorerDelete(scorer);
+        alignDatabase(&aligned, &aligned_lengths, &database, &database_length,
+            database_path, aligned_queries.data(), aligned_queries_length, indices, algorithm,
+            evalue_params, max_evalue, max_alignments, scorer, cards, cards_length);
 
-    if (sub_results) {
+        deleteEValueParams(evalue_params);
+        scorerDelete(scorer);
+
+        for (int32_t i = 0; i < aligned_queries_length; ++i) {
+            alignments[groups[i]] = aligned[i];
+            alignments_lenghts[groups[i]] = aligned_lengths[i];
+        }
+
+        free(aligned);
+        free(aligned_lengths);
+
+        is_first_search = false;
+    };
+
+    align_groups(aligned_groups);
+
+    // a resumed run keeps the alignment file of all queries
+    if (sub_results && (checkpoint == nullptr || !checkpoint->isAlignmentFileWritten())) {
         char* alignments_path = createFileName("alignments", out_path, ".txt");
-        outputShotgunDatabase(alignments, alignments_lenghts, queries_length, alignments_path, out_format);
+        outputShotgunDatabase(alignments, alignments_lenghts, unique_queries_length, alignments_path, out_format);
         delete[] alignments_path;
+
+        if (checkpoint != nullptr) {
+            checkpoint->setAlignmentFileWritten();
+        }
     }
 
-    std::vector<std::vector<Chain*>> alignment_strings;
-    selectAlignments(alignment_strings, alignments, alignments_lenghts, queries, queries_length, median_threshold);
+    std::vector<PredictionSettings> settings;
+    createPredictionSettings(settings, median_thresholds, sequence_identities, out_path,
+        archive, score_store);
+
+    // archives are written at the end, their queries are never completed early
+    if (checkpoint != nullptr && !archive && !score_store) {
+        for (uint32_t i = 0; i < settings.size(); ++i) {
+            settings[i].completed_path = checkpoint->completedPath(i);
+        }
+    }
 
-    deleteShotgunDatabase(alignments, alignments_lenghts, queries_length);
-    deleteFastaChains(database, database_length);
+    siftPredictions(alignments, alignments_lenghts, query_groups, queries, substitutions,
+        settings, sub_results, cache.get(), cached_groups, timings.get(), align_groups);
 
-    if (sub_results) {
-        outputSelectedAlignments(alignment_strings, queries, queries_length, out_path);
+    deleteShotgunDatabase(alignments, alignments_lenghts, unique_queries_length);
+    if (database != nullptr) {
+        deleteFastaChains(database, database_length);
     }
 
-    siftPredictions(alignment_strings, queries, queries_length, subst_path,
-        sequence_identity, out_path);
+    if (print_timings) {
+        char* timings_path = createFileName("timings", out_path, ".txt");
+        timings->print(timings_path, queries, queries_length);
+        delete[] timings_path;
+    }
+
+    if (checkpoint != nullptr) {
+        checkpoint->remove();
+    }
 
-    deleteSelectedAlignments(alignment_strings);
     deleteFastaChains(queries, queries_length);
 
     threadPoolTerminate();
@@ -261,6 +694,22 @@ static void getCudaCards(int** cards, int* cardsLen, char* optarg) {
     }
 }
 
+static void getList(std::vector<std::string>& dst, char* optarg) {
+
+    dst.clear();
+
+    // duplicates are ignored
+    char* token = strtok(optarg, ",");
+    while (token != nullptr) {
+        if (std::find(dst.begin(), dst.end(), token) == dst.end()) {
+            dst.emplace_back(token);
+        }
+        token = strtok(nullptr, ",");
+    }
+
+    ASSERT(!dst.empty(), "invalid list '%s'", optarg);
+}
+
 static int getOutFormat(char* optarg) {
 
     for (uint32_t i = 0; i < CHAR_INT_LEN(outFormats); ++i) {
@@ -286,6 +735,11 @@ static int getAlgorithm(char* optarg) {
 static void help() {
     printf(
     "usage: sift4g -q <query file> -d <database file> [arguments ...]\n"
+    "       sift4g --extract <archive file> [--out <directory>] [--list] [names ...]\n"
+    "       sift4g --lookup <score store file> [<protein> <position> <amino acid> ...]\n"
+    "       sift4g --serve <spool directory> -d <database file> [arguments ...]\n"
+    "       sift4g --database-stats -d <database file>\n"
+    "       sift4g --database-clusters -d <database file>\n"
     "\n"
     "arguments:\n"
     "    -q, --query <file>\n"
@@ -336,7 +790,8 @@ static void help() {
     "    --sub-results\n"
     "        prints sub results (alignment file and a file per query containing\n"
     "        its selected alignments forp rediction) to same directory defined\n"
-    "        with --out\n"
+    "        with --out; alignments of queries with identical sequences are listed\n"
+    "        once in the alignment file, under the first of their names\n"
     "    --outfmt <string>\n"
     "        default: bm9\n"
     "        out format for the alignment file, must be one of the following:\n"
@@ -351,18 +806,116 @@ static void help() {
     "    --max-candidates <int>\n"
     "        default: 5000\n"
     "        number of database sequences passed on to the Smith-Waterman part\n"
-    "    --median-threshold <float>\n"
+    "    --median-threshold <floats>\n"
     "        default: 2.75\n"
-    "        represents alignment diversity, used to output only a set of alignments\n"
+    "        represents alignment diversity, used to output only a set of alignments;\n"
+    "        a comma delimited list of values runs a parameter sweep, see --seq-id\n"
     "    --subst <string>\n"
     "        default: current directory\n"
     "        directory containing substitution files for each query (extension .subst)\n"
     "        files must have the same name as their corresponding query in FASTA file\n"
-    "    --seq-id <int>\n"
+    "    --seq-id <ints>\n"
     "        default: 100\n"
+    "        sequences more identical to the query (in percent) are removed from\n"
+    "        the alignment; a comma delimited list of values runs a parameter sweep:\n"
+    "        database search and alignment are done once and predictions of each\n"
+    "        combination of median thresholds and sequence identities are written\n"
+    "        to subdirectory threshold_<float>_seq_id_<int> of the directory\n"
+    "        defined with --out\n"
     "    -t, --threads <int>\n"
     "        default: 8\n"
     "        number of threads used in thread pool\n"
+    "    --timings\n"
+    "        prints time spent in each processing stage of each query to file\n"
+    "        timings.txt in the directory defined with --out\n"
+    "    --archive\n"
+    "        stores SIFT predictions and selected alignments of all queries in\n"
+    "        a single indexed archive results.s4g in the directory defined with\n"
+    "        --out instead of one file per query\n"
+    "    --extract <file>\n"
+    "        extracts files from an archive created with --archive to the directory\n"
+    "        defined with --out and exits; if names are given, only files of those\n"
+    "        queries (or files with those names) are extracted\n"
+    "    --list\n"
+    "        used with --extract, prints names and sizes of archived files instead\n"
+    "    --score-store\n"
+    "        additionally stores scores, median sequence info and number of sequences\n"
+    "        of all positions of all queries in a memory mappable binary file\n"
+    "        scores.s4gs in the directory defined with --out (median sequence info\n"
+    "        is calculated for every position, which takes additional time)\n"
+    "    --cache <directory>\n"
+    "        directory of selected alignments kept between runs, queries whose\n"
+    "        sequence was already processed with the same database file and\n"
+    "        search, alignment and selection options are not searched nor aligned\n"
+    "        again (their alignments are missing from the alignment file of\n"
+    "        --sub-results); the directory can be shared by concurrent runs\n"
+    "    --checkpoint <directory>\n"
+    "        default: directory sift4g_checkpoint in the directory defined with --out\n"
+    "        work directory holding candidate sequences of database search and\n"
+    "        completed queries (unless --archive or --score-store are used); a run\n"
+    "        interrupted at any point and started again with the same input files\n"
+    "        and options resumes from it, aligning the candidates of queries which\n"
+    "        were not completed, it is removed once the run finishes (changes of\n"
+    "        substitution files are not detected); each run uses a subdirectory\n"
+    "        named after a hash of its input files and options, which is locked\n"
+    "        while the run is active, so runs can share the directory\n"
+    "    --no-checkpoint\n"
+    "        disables the work directory of --checkpoint\n"
+    "    --search-state <file>\n"
+    "        keeps scored candidate sequences of each query in the file; when the\n"
+    "        database file only had sequences appended since the previous run, queries\n"
+    "        of that run are compared with the appended sequences only and their\n"
+    "        candidates are merged (e-values use the size of the whole database),\n"
+    "        other queries and changed databases are searched in full\n"
+    "    --seg\n"
+    "        masks low-complexity regions (SEG with window 12 and entropy cutoffs\n"
+    "        2.2 and 2.5 bits) of queries and database sequences for the k-mer\n"
+    "        matching of database search, alignments use whole sequences\n"
+    "    --stop-words <int>\n"
+    "        default: 0\n"
+    "        leaves the given number of most frequent database k-mers out of the\n"
+    "        k-mer matching of database search; frequencies are counted in the\n"
+    "        first ~250MB of the database file (with --search-state, in the part of\n"
+    "        them searched before), the share of k-mer hits removed is reported\n"
+    "    --adaptive-search\n"
+    "        database search uses k-mer length 3 for queries shorter than 100\n"
+    "        residues, 4 for queries shorter than 300 residues and 5 with half of\n"
+    "        --max-candidates for longer ones (--kmer-length is not used); the\n"
+    "        database is still read once\n"
+    "    --collapse-duplicates\n"
+    "        database search compares queries only with the first of identical\n"
+    "        database sequences, each of its candidates is replaced with its copies\n"
+    "        (best scoring first, at most --max-candidates sequences per query are\n"
+    "        aligned); identical sequences are read from <database file>.clusters if\n"
+    "        it was created for the unchanged database file (--database-clusters),\n"
+    "        otherwise the database file is read one more time\n"
+    "    --database-clusters\n"
+    "        reads the database file given with -d once, writes the identical\n"
+    "        sequences to <database file>.clusters for --collapse-duplicates, prints\n"
+    "        the number of sequences and distinct sequences and exits\n"
+    "    --database-stats\n"
+    "        reads the database file given with -d once, writes its number of\n"
+    "        sequences, number of residues and sequence length histogram to\n"
+    "        <database file>.stats, prints them and exits; later runs with the\n"
+    "        unchanged database file take its size from there\n"
+    "    --database-cells <int>\n"
+    "        default: size of the database\n"
+    "        number of residues used for e-value statistics\n"
+    "    --lookup <file>\n"
+    "        prints score, median sequence info, number of sequences at the position\n"
+    "        and total number of sequences for each given protein, position (starting\n"
+    "        at 1) and amino acid from a score store created with --score-store and\n"
+    "        exits\n"
+    "    --serve <directory>\n"
+    "        keeps the database in memory and processes jobs from the spool directory\n"
+    "        until interrupted; a job is a directory <name>.job containing queries.fasta\n"
+    "        and optional substitution files (create it under another name and rename\n"
+    "        it once complete); predictions (and sub results) are written into it and\n"
+    "        it is renamed to <name>.done, or to <name>.failed if it can not be read or\n"
+    "        has no valid queries (<name>.<n>.done or <name>.<n>.failed if a job with\n"
+    "        the same name is still there); jobs waiting together are searched and\n"
+    "        aligned together, options other than search, alignment and prediction\n"
+    "        ones are ignored\n"
     "    -h, -help\n"
     "        prints out the help\n");
 }
@@ -0,0 +1,116 @@
+/*!
+ * @file msa.cpp
+ *
+ * @brief Msa class source file
+ *
+ * @author: rvaser
+ */
+
+#include <algorithm>
+
+#include "msa.hpp"
+#include "utils.hpp"
+
+uint8_t msaEncode(char c) {
+    if (c >= 'A' && c <= 'Z') {
+        return c - 'A';
+    }
+    if (c >= 'a' && c <= 'z') {
+        return c - 'a';
+    }
+    return kMsaX;
+}
+
+std::unique_ptr<Msa> createMsa(uint32_t length) {
+
+    ASSERT(length, "invalid msa length");
+
+    return std::unique_ptr<Msa>(new Msa(length));
+}
+
+Msa::Msa(uint32_t length)
+        : length_(length) {
+}
+
+void Msa::append(const std::string& name, const char* residues) {
+    insert(names_.size(), name, residues);
+}
+
+void Msa::insert(uint32_t i, const std::string& name, const char* residues) {
+
+    names_.insert(names_.begin() + i, name);
+    weights_.insert(weights_.begin() + i, 1.0);
+
+    auto it = data_.insert(data_.begin() + i * (size_t) length_, length_, kMsaX);
+    for (uint32_t j = 0; j < length_; ++j, ++it) {
+        *it = msaEncode(residues[j]);
+    }
+
+    std::vector<uint8_t>().swap(columns_);
+}
+
+void Msa::erase(const std::vector<bool>& remove) {
+
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < names_.size(); ++i) {
+        if (remove[i]) {
+            continue;
+        }
+        if (size != i) {
+            names_[size].swap(names_[i]);
+            weights_[size] = weights_[i];
+            std::copy(data_.begin() + i * (size_t) length_, data_.begin() + (i + 1) * (size_t) length_,
+                data_.begin() + size * (size_t) length_);
+        }
+        ++size;
+    }
+
+    resize(size);
+}
+
+void Msa::resize(uint32_t size) {
+
+    if (size >= names_.size()) {
+        return;
+    }
+
+    names_.resize(size);
+    weights_.resize(size);
+    data_.resize(size * (size_t) length_);
+
+    std::vector<uint8_t>().swap(columns_);
+}
+
+void Msa::transpose() {
+
+    uint32_t size = names_.size();
+    columns_.resize(data_.size());
+
+    for (uint32_t i = 0; i < size; ++i) {
+        const uint8_t* src = row(i);
+        for (uint32_t j = 0; j < length_; ++j) {
+            columns_[j * (size_t) size + i] = src[j];
+        }
+    }
+}
+
+std::unique_ptr<Msa> Msa::subset(const std::vector<uint32_t>& rows) const {
+
+    auto dst = createMsa(length_);
+
+    dst->names_.reserve(rows.size());
+    dst->weights_.reserve(rows.size());
+    dst->data_.reserve(rows.size() * (size_t) length_);
+
+    for (const auto& it: rows) {
+        dst->names_.emplace_back(names_[it]);
+        dst->weights_.emplace_back(weights_[it]);
+        dst->data_.insert(dst->data_.end(), row(it), row(it) + length_);
+    }
+
+    if (!columns_.empty()) {
+        dst->transpose();
+    }
+
+    return dst;
+}
@@ -0,0 +1,101 @@
+/*!
+ * @file msa.hpp
+ *
+ * @brief Msa class header file
+ *
+ * @author: rvaser
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* residues are stored as codes 0-25 ('A'-'Z'), anything else is stored as 'X' */
+constexpr uint8_t kMsaX = 'X' - 'A';
+constexpr uint32_t kMsaCodes = 26;
+
+uint8_t msaEncode(char c);
+
+inline char msaDecode(uint8_t code) {
+    return code + 'A';
+}
+
+class Msa;
+
+std::unique_ptr<Msa> createMsa(uint32_t length);
+
+/*!
+ * @brief Contiguous multiple sequence alignment where every row has the length
+ * of the query. Rows are kept in row-major order, while the column-major view
+ * has to be created explicitly with transpose() after the rows are final.
+ */
+class Msa {
+public:
+
+    ~Msa() {};
+
+    uint32_t length() const {
+        return length_;
+    }
+
+    uint32_t size() const {
+        return names_.size();
+    }
+
+    const std::string& name(uint32_t i) const {
+        return names_[i];
+    }
+
+    const uint8_t* row(uint32_t i) const {
+        return &data_[i * (size_t) length_];
+    }
+
+    uint8_t code(uint32_t i, uint32_t j) const {
+        return data_[i * (size_t) length_ + j];
+    }
+
+    /* valid only after transpose() */
+    const uint8_t* column(uint32_t j) const {
+        return &columns_[j * (size_t) names_.size()];
+    }
+
+    /* per row weights, initialized to 1 */
+    std::vector<double>& weights() {
+        return weights_;
+    }
+
+    const std::vector<double>& weights() const {
+        return weights_;
+    }
+
+    void append(const std::string& name, const char* residues);
+
+    void insert(uint32_t i, const std::string& name, const char* residues);
+
+    /* removes rows i for which remove[i] is true */
+    void erase(const std::vector<bool>& remove);
+
+    void resize(uint32_t size);
+
+    void transpose();
+
+    std::unique_ptr<Msa> subset(const std::vector<uint32_t>& rows) const;
+
+    friend std::unique_ptr<Msa> createMsa(uint32_t length);
+
+private:
+
+    Msa(uint32_t length);
+
+    Msa(const Msa&) = delete;
+    const Msa& operator=(const Msa&) = delete;
+
+    uint32_t length_;
+    std::vector<std::string> names_;
+    std::vector<uint8_t> data_;
+    std::vector<uint8_t> columns_;
+    std::vector<double> weights_;
+};
@@ -0,0 +1,233 @@
+/*!
+ * @file output_archive.cpp
+ *
+ * @brief OutputArchive class source file
+ *
+ * @author: rvaser
+ */
+
+#include <string.h>
+
+#include "utils.hpp"
+#include "output_archive.hpp"
+
+constexpr char kArchiveMagic[] = "S4GARCH1";
+constexpr char kIndexMagic[] = "S4GINDX1";
+constexpr uint32_t kMagicLength = 8;
+constexpr uint32_t kFooterLength = 2 * sizeof(uint64_t) + kMagicLength;
+
+/* record names are query or file names, extracted records are limited to the usual
+file system maximum */
+constexpr uint32_t kMaxNameLength = 4096;
+constexpr uint32_t kMaxFileNameLength = 255;
+
+/* records are small, a large buffer keeps the number of write calls low */
+constexpr size_t kArchiveBufferSize = 4 << 20;
+
+static void writeUint(FILE* out, uint64_t value, uint32_t bytes) {
+    unsigned char buffer[sizeof(uint64_t)];
+    for (uint32_t i = 0; i < bytes; ++i) {
+        buffer[i] = (value >> (8 * i)) & 0xFF;
+    }
+    fwrite(buffer, 1, bytes, out);
+}
+
+static uint64_t readUint(const unsigned char* src, uint32_t bytes) {
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < bytes; ++i) {
+        value |= (uint64_t) src[i] << (8 * i);
+    }
+    return value;
+}
+
+std::unique_ptr<OutputArchive> createOutputArchive(const std::string& path) {
+
+    FILE* out = fopen(path.c_str(), "wb");
+    ASSERT(out, "unable to open file '%s'", path.c_str());
+
+    return std::unique_ptr<OutputArchive>(new OutputArchive(out, path));
+}
+
+OutputArchive::OutputArchive(FILE* out, const std::string& path)
+        : out_(out), path_(path), offset_(kMagicLength) {
+
+    setvbuf(out_, nullptr, _IOFBF, kArchiveBufferSize);
+    fwrite(kArchiveMagic, 1, kMagicLength, out_);
+}
+
+OutputArchive::~OutputArchive() {
+
+    uint64_t index_offset = offset_;
+
+    for (const auto& it: entries_) {
+        writeUint(out_, it.name.size(), sizeof(uint32_t));
+        fwrite(it.name.data(), 1, it.name.size(), out_);
+        writeUint(out_, it.offset, sizeof(uint64_t));
+        writeUint(out_, it.size, sizeof(uint64_t));
+    }
+
+    writeUint(out_, index_offset, sizeof(uint64_t));
+    writeUint(out_, entries_.size(), sizeof(uint64_t));
+    fwrite(kIndexMagic, 1, kMagicLength, out_);
+
+    ASSERT(ferror(out_) == 0 && fclose(out_) == 0, "unable to write file '%s'", path_.c_str());
+}
+
+static bool isValidName(const std::string& name) {
+    return !name.empty() && name.size() <= kMaxNameLength && name.find('\0') == std::string::npos;
+}
+
+/* records are extracted as files into the output directory, so only plain file names
+can be extracted */
+static bool isFileName(const std::string& name) {
+    return name.size() <= kMaxFileNameLength && name != "." && name != ".." &&
+        name.find('/') == std::string::npos;
+}
+
+void OutputArchive::add(const std::string& name, const std::string& data) {
+
+    // the same rule is applied when reading the index
+    if (!isValidName(name)) {
+        fprintf(stderr, "** Record name '%s' is not valid, the record is left out of archive "
+            "'%s' **\n", name.c_str(), path_.c_str());
+        return;
+    }
+
+    // aligned records can be read in place from a memory mapped archive
+    while (offset_ % kArchiveAlignment != 0) {
+        fputc(0, out_);
+        ++offset_;
+    }
+
+    ASSERT(fwrite(data.data(), 1, data.size(), out_) == data.size(),
+        "unable to write file '%s'", path_.c_str());
+
+    entries_.push_back({name, offset_, data.size()});
+    offset_ += data.size();
+}
+
+static FILE* openArchive(const std::string& path, std::vector<ArchiveEntry>& dst) {
+
+    FILE* in = fopen(path.c_str(), "rb");
+    ASSERT(in, "unable to open file '%s'", path.c_str());
+
+    char magic[kMagicLength];
+    ASSERT(fread(magic, 1, kMagicLength, in) == kMagicLength &&
+        memcmp(magic, kArchiveMagic, kMagicLength) == 0, "invalid archive '%s'", path.c_str());
+
+    unsigned char footer[kFooterLength];
+    ASSERT(fseeko(in, -(off_t) kFooterLength, SEEK_END) == 0 &&
+        fread(footer, 1, kFooterLength, in) == kFooterLength &&
+        memcmp(footer + 2 * sizeof(uint64_t), kIndexMagic, kMagicLength) == 0,
+        "missing index in archive '%s' (incomplete run?)", path.c_str());
+
+    uint64_t index_offset = readUint(footer, sizeof(uint64_t));
+    uint64_t entries_length = readUint(footer + sizeof(uint64_t), sizeof(uint64_t));
+    off_t index_end = ftello(in) - kFooterLength;
+
+    ASSERT(fseeko(in, index_offset, SEEK_SET) == 0, "invalid archive '%s'", path.c_str());
+
+    std::vector<unsigned char> index(index_end - index_offset);
+    ASSERT(fread(index.data(), 1, index.size(), in) == index.size(), "invalid archive '%s'", path.c_str());
+
+    dst.clear();
+    dst.reserve(entries_length);
+
+    uint64_t i = 0;
+    for (uint64_t j = 0; j < entries_length; ++j) {
+        ASSERT(i + sizeof(uint32_t) <= index.size(), "invalid archive '%s'", path.c_str());
+        uint32_t name_length = readUint(&index[i], sizeof(uint32_t));
+        i += sizeof(uint32_t);
+
+        ASSERT(i + name_length + 2 * sizeof(uint64_t) <= index.size(), "invalid archive '%s'", path.c_str());
+        ArchiveEntry entry;
+        entry.name.assign((const char*) &index[i], name_length);
+        i += name_length;
+        entry.offset = readUint(&index[i], sizeof(uint64_t));
+        entry.size = readUint(&index[i + sizeof(uint64_t)], sizeof(uint64_t));
+        i += 2 * sizeof(uint64_t);
+
+        ASSERT(entry.offset + entry.size <= index_offset, "invalid archive '%s'", path.c_str());
+
+        // one bad name must not make the remaining records unreadable
+        if (!isValidName(entry.name)) {
+            fprintf(stderr, "** Skipping record with invalid name '%s' in archive '%s' **\n",
+                entry.name.c_str(), path.c_str());
+            continue;
+        }
+
+        dst.emplace_back(std::move(entry));
+    }
+
+    return in;
+}
+
+void readArchiveIndex(const std::string& path, std::vector<ArchiveEntry>& dst) {
+    fclose(openArchive(path, dst));
+}
+
+void listArchive(const std::string& path) {
+
+    std::vector<ArchiveEntry> entries;
+    readArchiveIndex(path, entries);
+
+    for (const auto& it: entries) {
+        printf("%s\t%llu\n", it.name.c_str(), (unsigned long long) it.size);
+    }
+}
+
+static bool isSelected(const std::string& name, const std::vector<std::string>& names) {
+
+    if (names.empty()) {
+        return true;
+    }
+
+    for (const auto& it: names) {
+        if (name.compare(0, it.size(), it) == 0 &&
+            (name.size() == it.size() || name[it.size()] == '.')) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void extractArchive(const std::string& path, const std::string& out_path,
+    const std::vector<std::string>& names) {
+
+    std::vector<ArchiveEntry> entries;
+    FILE* in = openArchive(path, entries);
+
+    std::string data;
+    uint32_t extracted = 0;
+
+    for (const auto& it: entries) {
+        if (!isSelected(it.name, names)) {
+            continue;
+        }
+        if (!isFileName(it.name)) {
+            fprintf(stderr, "** Record '%s' is not a plain file name and is not extracted **\n",
+                it.name.c_str());
+            continue;
+        }
+
+        data.resize(it.size);
+        ASSERT(fseeko(in, it.offset, SEEK_SET) == 0 &&
+            fread(&data[0], 1, it.size, in) == it.size, "invalid archive '%s'", path.c_str());
+
+        char* out_file_name = createFileName(it.name.c_str(), out_path, "");
+
+        FILE* out = fopen(out_file_name, "w");
+        ASSERT(out, "unable to open file '%s'", out_file_name);
+        ASSERT(fwrite(data.data(), 1, data.size(), out) == data.size(),
+            "unable to write file '%s'", out_file_name);
+        fclose(out);
+
+        delete[] out_file_name;
+        ++extracted;
+    }
+
+    fclose(in);
+
+    fprintf(stderr, "** Extracted %u files from archive '%s' **\n", extracted, path.c_str());
+}
@@ -0,0 +1,73 @@
+/*!
+ * @file output_archive.hpp
+ *
+ * @brief OutputArchive class header file
+ *
+ * @author: rvaser
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <memory>
+
+/*!
+ * @brief Archive layout (integers are little endian):
+ *     magic "S4GARCH1"
+ *     data of each record, one after another, starting at multiples of kArchiveAlignment
+ *     index, for each record: uint32 name length, name, uint64 offset, uint64 size
+ *     footer: uint64 index offset, uint64 number of records, magic "S4GINDX1"
+ */
+constexpr uint64_t kArchiveAlignment = 8;
+
+class ArchiveEntry {
+public:
+    std::string name;
+    uint64_t offset;
+    uint64_t size;
+};
+
+class OutputArchive;
+std::unique_ptr<OutputArchive> createOutputArchive(const std::string& path);
+
+/*!
+ * @brief Append-only container of named records, the index is written by the
+ * destructor. Records with the same name are kept, extraction keeps the last one.
+ * Not thread safe.
+ */
+class OutputArchive {
+public:
+
+    ~OutputArchive();
+
+    /* records with an empty name, a name longer than 4096 characters or containing '\0'
+    are left out with a warning, readers skip such records the same way */
+    void add(const std::string& name, const std::string& data);
+
+    friend std::unique_ptr<OutputArchive> createOutputArchive(const std::string& path);
+
+private:
+
+    OutputArchive(FILE* out, const std::string& path);
+    OutputArchive(const OutputArchive&) = delete;
+    const OutputArchive& operator=(const OutputArchive&) = delete;
+
+    FILE* out_;
+    std::string path_;
+    uint64_t offset_;
+    std::vector<ArchiveEntry> entries_;
+};
+
+void readArchiveIndex(const std::string& path, std::vector<ArchiveEntry>& dst);
+
+/* prints name and size of each record to stdout */
+void listArchive(const std::string& path);
+
+/* writes records to out_path, if names are given only records with one of the names or
+whose name starts with one of the names followed by a '.' (e.g. query names) are extracted;
+records whose name is not a plain file name (e.g. contains '/') are skipped with a warning */
+void extractArchive(const std::string& path, const std::string& out_path,
+    const std::vector<std::string>& names);
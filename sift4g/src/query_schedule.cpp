@@ -0,0 +1,103 @@
+/*!
+ * @file query_schedule.cpp
+ *
+ * @brief Query scheduling and stage timings source file
+ *
+ * @author: rvaser
+ */
+
+#include <stdio.h>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+#include "utils.hpp"
+#include "query_schedule.hpp"
+
+static const char* kStageNames[kQueryStages] = {
+    "selection", "weighting", "scoring", "median_seq_info", "output"
+};
+
+std::vector<uint32_t> scheduleQueries(const std::vector<uint64_t>& costs) {
+
+    std::vector<uint32_t> order(costs.size());
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+
+    std::stable_sort(order.begin(), order.end(),
+        [&costs](uint32_t a, uint32_t b) { return costs[a] > costs[b]; });
+
+    return order;
+}
+
+void groupIdenticalQueries(std::vector<std::vector<uint32_t>>& dst, Chain** queries,
+    int32_t queries_length) {
+
+    dst.clear();
+
+    std::unordered_map<std::string, uint32_t> groups;
+    groups.reserve(queries_length);
+
+    for (int32_t i = 0; i < queries_length; ++i) {
+        std::string sequence(chainGetLength(queries[i]), 0);
+        for (uint32_t j = 0; j < sequence.size(); ++j) {
+            sequence[j] = chainGetChar(queries[i], j);
+        }
+
+        auto it = groups.emplace(std::move(sequence), dst.size());
+        if (it.second) {
+            dst.emplace_back();
+        }
+        dst[it.first->second].emplace_back(i);
+    }
+}
+
+uint64_t timerNow() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::unique_ptr<QueryTimings> createQueryTimings(uint32_t queries_length) {
+    return std::unique_ptr<QueryTimings>(new QueryTimings(queries_length));
+}
+
+QueryTimings::QueryTimings(uint32_t queries_length)
+        : queries_length_(queries_length),
+        durations_(new std::atomic<uint64_t>[queries_length * (size_t) kQueryStages]) {
+
+    for (size_t i = 0; i < queries_length * (size_t) kQueryStages; ++i) {
+        durations_[i] = 0;
+    }
+}
+
+void QueryTimings::add(uint32_t query, QueryStage stage, uint64_t begin) {
+    durations_[query * (size_t) kQueryStages + stage] += timerNow() - begin;
+}
+
+void QueryTimings::print(const char* path, Chain** queries, int32_t queries_length) const {
+
+    FILE* out = fopen(path, "w");
+    ASSERT(out, "unable to open timings file '%s'", path);
+
+    fprintf(out, "query\tlength");
+    for (uint32_t j = 0; j < kQueryStages; ++j) {
+        fprintf(out, "\t%s", kStageNames[j]);
+    }
+    fprintf(out, "\ttotal\n");
+
+    for (int32_t i = 0; i < queries_length && i < (int32_t) queries_length_; ++i) {
+        fprintf(out, "%s\t%d", chainGetName(queries[i]), chainGetLength(queries[i]));
+
+        uint64_t total = 0;
+        for (uint32_t j = 0; j < kQueryStages; ++j) {
+            uint64_t duration = durations_[i * (size_t) kQueryStages + j];
+            fprintf(out, "\t%.6f", duration / 1e6);
+            total += duration;
+        }
+        fprintf(out, "\t%.6f\n", total / 1e6);
+    }
+
+    fclose(out);
+}
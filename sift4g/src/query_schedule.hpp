@@ -0,0 +1,72 @@
+/*!
+ * @file query_schedule.hpp
+ *
+ * @brief Query scheduling and stage timings header file
+ *
+ * @author: rvaser
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+#include "swsharp/swsharp.h"
+
+/* returns query indices ordered by decreasing cost (longest processing time
+first), queries with equal cost keep their input order */
+std::vector<uint32_t> scheduleQueries(const std::vector<uint64_t>& costs);
+
+/* groups queries with identical sequences, each group holds query indices in input
+order and groups are ordered by their first query */
+void groupIdenticalQueries(std::vector<std::vector<uint32_t>>& dst, Chain** queries,
+    int32_t queries_length);
+
+enum QueryStage {
+    kStageSelection,
+    kStageWeighting,
+    kStageScoring,
+    kStageMedianSeqInfo,
+    kStageOutput,
+    kQueryStages
+};
+
+/* microseconds elapsed since an arbitrary fixed point */
+uint64_t timerNow();
+
+class QueryTimings;
+std::unique_ptr<QueryTimings> createQueryTimings(uint32_t queries_length);
+
+/*!
+ * @brief Time spent in each processing stage of each query, summed over all
+ * tasks of a stage. Durations can be added from multiple threads.
+ */
+class QueryTimings {
+public:
+
+    /* adds timerNow() - begin to the stage of the query */
+    void add(uint32_t query, QueryStage stage, uint64_t begin);
+
+    /* tab separated table with one line per query, times in seconds */
+    void print(const char* path, Chain** queries, int32_t queries_length) const;
+
+    friend std::unique_ptr<QueryTimings> createQueryTimings(uint32_t queries_length);
+
+private:
+
+    QueryTimings(uint32_t queries_length);
+    QueryTimings(const QueryTimings&) = delete;
+    const QueryTimings& operator=(const QueryTimings&) = delete;
+
+    uint32_t queries_length_;
+    std::unique_ptr<std::atomic<uint64_t>[]> durations_;
+};
+
+/* no-op if timings is nullptr */
+inline void queryTimingsAdd(QueryTimings* timings, uint32_t query, QueryStage stage, uint64_t begin) {
+    if (timings != nullptr) {
+        timings->add(query, stage, begin);
+    }
+}
@@ -0,0 +1,118 @@
+/*!
+ * @file score_matrix.cpp
+ *
+ * @brief ScoreMatrix class source file
+ *
+ * @author: rvaser
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "utils.hpp"
+#include "score_matrix.hpp"
+
+/* number of released buffers kept by each thread */
+constexpr uint32_t kArenaMaxBuffers = 16;
+
+class MatrixArena {
+public:
+
+    ~MatrixArena() {
+        for (const auto& it: buffers_) {
+            free(it.second);
+        }
+    }
+
+    double* acquire(size_t size, size_t& capacity) {
+
+        int32_t best = -1;
+        for (uint32_t i = 0; i < buffers_.size(); ++i) {
+            if (buffers_[i].first >= size && (best == -1 || buffers_[i].first < buffers_[best].first)) {
+                best = i;
+            }
+        }
+
+        if (best != -1) {
+            double* data = buffers_[best].second;
+            capacity = buffers_[best].first;
+            buffers_[best] = buffers_.back();
+            buffers_.pop_back();
+            return data;
+        }
+
+        void* data = nullptr;
+        ASSERT(posix_memalign(&data, kMatrixAlignment, size * sizeof(double)) == 0,
+            "unable to allocate score matrix");
+        capacity = size;
+
+        return (double*) data;
+    }
+
+    void release(double* data, size_t capacity) {
+
+        buffers_.emplace_back(capacity, data);
+
+        if (buffers_.size() > kArenaMaxBuffers) {
+            uint32_t smallest = 0;
+            for (uint32_t i = 1; i < buffers_.size(); ++i) {
+                if (buffers_[i].first < buffers_[smallest].first) {
+                    smallest = i;
+                }
+            }
+            free(buffers_[smallest].second);
+            buffers_[smallest] = buffers_.back();
+            buffers_.pop_back();
+        }
+    }
+
+private:
+
+    std::vector<std::pair<size_t, double*>> buffers_;
+};
+
+static thread_local MatrixArena arena;
+
+ScoreMatrix::ScoreMatrix(uint32_t length)
+        : length_(length), capacity_(0), data_(nullptr) {
+
+    data_ = arena.acquire(std::max<size_t>(length_, 1) * kMatrixWidth, capacity_);
+    clear();
+}
+
+ScoreMatrix::ScoreMatrix(ScoreMatrix&& other)
+        : length_(other.length_), capacity_(other.capacity_), data_(other.data_) {
+    other.length_ = 0;
+    other.capacity_ = 0;
+    other.data_ = nullptr;
+}
+
+ScoreMatrix& ScoreMatrix::operator=(ScoreMatrix&& other) {
+    if (this != &other) {
+        release();
+        std::swap(length_, other.length_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(data_, other.data_);
+    }
+    return *this;
+}
+
+ScoreMatrix::~ScoreMatrix() {
+    release();
+}
+
+void ScoreMatrix::clear() {
+    memset(data_, 0, length_ * (size_t) kMatrixWidth * sizeof(double));
+}
+
+void ScoreMatrix::release() {
+    if (data_ != nullptr) {
+        arena.release(data_, capacity_);
+        data_ = nullptr;
+        capacity_ = 0;
+        length_ = 0;
+    }
+}
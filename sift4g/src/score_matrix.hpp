@@ -0,0 +1,56 @@
+/*!
+ * @file score_matrix.hpp
+ *
+ * @brief ScoreMatrix class header file
+ *
+ * @author: rvaser
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* amino acids 'A' - 'Z' are padded to 32 doubles for each position */
+constexpr uint32_t kMatrixWidth = 32;
+constexpr uint32_t kMatrixAlignment = 64;
+
+/*!
+ * @brief Zero initialized position x kMatrixWidth matrix of doubles stored in
+ * one aligned buffer. Buffers are drawn from an arena local to the creating
+ * thread and returned to the arena of the destroying thread, so queries
+ * processed one after another reuse the same memory.
+ */
+class ScoreMatrix {
+public:
+
+    explicit ScoreMatrix(uint32_t length);
+    ScoreMatrix(ScoreMatrix&& other);
+    ScoreMatrix& operator=(ScoreMatrix&& other);
+    ~ScoreMatrix();
+
+    uint32_t length() const {
+        return length_;
+    }
+
+    double* operator[](uint32_t pos) {
+        return data_ + pos * (size_t) kMatrixWidth;
+    }
+
+    const double* operator[](uint32_t pos) const {
+        return data_ + pos * (size_t) kMatrixWidth;
+    }
+
+    void clear();
+
+private:
+
+    ScoreMatrix(const ScoreMatrix&) = delete;
+    const ScoreMatrix& operator=(const ScoreMatrix&) = delete;
+
+    void release();
+
+    uint32_t length_;
+    size_t capacity_;
+    double* data_;
+};
@@ -0,0 +1,152 @@
+/*!
+ * @file score_store.cpp
+ *
+ * @brief ScoreStore class source file
+ *
+ * @author: rvaser
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "utils.hpp"
+#include "output_archive.hpp"
+#include "score_store.hpp"
+
+constexpr uint32_t kRecordHeaderLength = 2 * sizeof(uint32_t);
+
+static int32_t aminoAcidIndex(char aa) {
+    const char* it = strchr(kScoreStoreAminoAcids, aa);
+    return (aa == '\0' || it == nullptr) ? -1 : it - kScoreStoreAminoAcids;
+}
+
+template<typename T>
+static void append(std::string& dst, T value) {
+    dst.append((const char*) &value, sizeof(T));
+}
+
+void printScoreStoreRecord(const ScoreMatrix& SIFTscores, const std::vector<double>& medianSeqInfoForPos,
+    const std::vector<double>& aas_stored, int total_seq, std::string& dst) {
+
+    uint32_t query_length = SIFTscores.length();
+
+    dst.reserve(dst.size() + kRecordHeaderLength + query_length * (sizeof(float) +
+        sizeof(uint32_t) + kScoreStoreWidth * sizeof(uint16_t)));
+
+    append<uint32_t>(dst, query_length);
+    append<uint32_t>(dst, total_seq);
+
+    for (uint32_t pos = 0; pos < query_length; ++pos) {
+        append<float>(dst, medianSeqInfoForPos[pos]);
+    }
+    for (uint32_t pos = 0; pos < query_length; ++pos) {
+        append<uint32_t>(dst, aas_stored[pos]);
+    }
+    for (uint32_t pos = 0; pos < query_length; ++pos) {
+        for (uint32_t i = 0; i < kScoreStoreWidth; ++i) {
+            double score = SIFTscores[pos][kScoreStoreAminoAcids[i] - 'A'];
+            append<uint16_t>(dst, std::isnan(score) ? kScoreStoreMissing :
+                (uint16_t) lround(std::min(std::max(score, 0.0), 1.0) * kScoreStoreScale));
+        }
+    }
+}
+
+std::unique_ptr<ScoreStore> createScoreStore(const std::string& path) {
+
+    int fd = open(path.c_str(), O_RDONLY);
+    ASSERT(fd != -1, "unable to open file '%s'", path.c_str());
+
+    struct stat info;
+    ASSERT(fstat(fd, &info) == 0 && info.st_size > 0, "invalid score store '%s'", path.c_str());
+
+    void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    ASSERT(data != MAP_FAILED, "unable to map file '%s'", path.c_str());
+
+    auto store = std::unique_ptr<ScoreStore>(new ScoreStore((const char*) data, info.st_size));
+
+    std::vector<ArchiveEntry> entries;
+    readArchiveIndex(path, entries);
+
+    for (const auto& it: entries) {
+        ASSERT(it.size >= kRecordHeaderLength, "invalid score store '%s'", path.c_str());
+
+        uint32_t query_length;
+        memcpy(&query_length, store->data_ + it.offset, sizeof(uint32_t));
+        ASSERT(it.size == kRecordHeaderLength + query_length * (uint64_t) (sizeof(float) +
+            sizeof(uint32_t) + kScoreStoreWidth * sizeof(uint16_t)),
+            "invalid record '%s' in score store '%s'", it.name.c_str(), path.c_str());
+
+        store->records_[it.name] = store->data_ + it.offset;
+    }
+
+    return store;
+}
+
+ScoreStore::ScoreStore(const char* data, uint64_t size)
+        : data_(data), size_(size) {
+}
+
+ScoreStore::~ScoreStore() {
+    munmap((void*) data_, size_);
+}
+
+bool ScoreStore::find(const std::string& protein, uint32_t pos, char aa, ScoreStoreValue& dst) const {
+
+    auto it = records_.find(protein);
+    int32_t aa_index = aminoAcidIndex(aa);
+
+    if (it == records_.end() || aa_index == -1) {
+        return false;
+    }
+
+    auto header = (const uint32_t*) it->second;
+    uint32_t query_length = header[0];
+
+    if (pos == 0 || pos > query_length) {
+        return false;
+    }
+    --pos;
+
+    auto medians = (const float*) (header + 2);
+    auto sequences = (const uint32_t*) (medians + query_length);
+    auto scores = (const uint16_t*) (sequences + query_length);
+
+    uint16_t score = scores[pos * kScoreStoreWidth + aa_index];
+
+    dst.score = score == kScoreStoreMissing ? NAN : score / kScoreStoreScale;
+    dst.median = medians[pos];
+    dst.sequences = sequences[pos];
+    dst.total_sequences = header[1];
+
+    return true;
+}
+
+void lookupScoreStore(const std::string& path, const std::vector<std::string>& triplets) {
+
+    ASSERT(triplets.size() % 3 == 0, "lookups must be given as triplets <protein> <position> <amino acid>");
+
+    auto store = createScoreStore(path);
+
+    for (uint32_t i = 0; i < triplets.size(); i += 3) {
+        const auto& protein = triplets[i];
+        uint32_t pos = atoi(triplets[i + 1].c_str());
+        char aa = triplets[i + 2].size() == 1 ? triplets[i + 2][0] : '\0';
+
+        ScoreStoreValue value;
+        if (store->find(protein, pos, aa, value)) {
+            printf("%s\t%u\t%c\t%.4f\t%.2f\t%u\t%u\n", protein.c_str(), pos, aa, value.score,
+                value.median, value.sequences, value.total_sequences);
+        } else {
+            printf("%s\t%s\t%s\tNA\tNA\tNA\tNA\n", protein.c_str(), triplets[i + 1].c_str(),
+                triplets[i + 2].c_str());
+        }
+    }
+}
@@ -0,0 +1,75 @@
+/*!
+ * @file score_store.hpp
+ *
+ * @brief ScoreStore class header file
+ *
+ * @author: rvaser
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include "score_matrix.hpp"
+
+/*!
+ * @brief Score store is an OutputArchive with one record per query named by the
+ * full query name. Records are 8 byte aligned and hold native little endian values:
+ *     uint32 query length L, uint32 total number of sequences
+ *     float median sequence info[L]
+ *     uint32 number of sequences with a valid amino acid[L]
+ *     uint16 scores[L][20], amino acids ordered as kScoreStoreAminoAcids
+ * Scores are quantised to 1/kScoreStoreScale (the precision of .SIFTprediction
+ * files), kScoreStoreMissing marks a score which is not a number.
+ */
+constexpr char kScoreStoreAminoAcids[] = "ACDEFGHIKLMNPQRSTVWY";
+constexpr uint32_t kScoreStoreWidth = 20;
+constexpr double kScoreStoreScale = 10000.0;
+constexpr uint16_t kScoreStoreMissing = 0xFFFF;
+
+/* appends the score store record of one query to dst */
+void printScoreStoreRecord(const ScoreMatrix& SIFTscores, const std::vector<double>& medianSeqInfoForPos,
+    const std::vector<double>& aas_stored, int total_seq, std::string& dst);
+
+class ScoreStoreValue {
+public:
+    double score;
+    double median;
+    uint32_t sequences; // sequences with a valid amino acid at the position
+    uint32_t total_sequences;
+};
+
+class ScoreStore;
+std::unique_ptr<ScoreStore> createScoreStore(const std::string& path);
+
+/*!
+ * @brief Read only view of a memory mapped score store.
+ */
+class ScoreStore {
+public:
+
+    ~ScoreStore();
+
+    /* pos starts at 1 as in substitution files, returns false if the protein is
+    not stored, pos is out of range or aa is not one of kScoreStoreAminoAcids */
+    bool find(const std::string& protein, uint32_t pos, char aa, ScoreStoreValue& dst) const;
+
+    friend std::unique_ptr<ScoreStore> createScoreStore(const std::string& path);
+
+private:
+
+    ScoreStore(const char* data, uint64_t size);
+    ScoreStore(const ScoreStore&) = delete;
+    const ScoreStore& operator=(const ScoreStore&) = delete;
+
+    const char* data_;
+    uint64_t size_;
+    std::unordered_map<std::string, const char*> records_;
+};
+
+/* prints the values of (protein, position, amino acid) triplets to stdout */
+void lookupScoreStore(const std::string& path, const std::vector<std::string>& triplets);
@@ -0,0 +1,142 @@
+/*!
+ * @file search_state.cpp
+ *
+ * @brief SearchState class source file
+ *
+ * @author: rvaser
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "utils.hpp"
+#include "search_state.hpp"
+
+/* file layout (integers in native byte order):
+ *     kStateMagic
+ *     uint32 length of parameters, parameters
+ *     uint32 database length, uint64 database digest, uint64 stop words digest,
+ *     uint32 number of queries
+ *     for each query: uint32 length, residue codes, uint32 number of candidates,
+ *         int32 id and float score of each candidate */
+constexpr char kStateMagic[] = "S4GSTAT3";
+constexpr uint32_t kMagicLength = 8;
+
+static std::string queryKey(Chain* query) {
+    return std::string(chainGetCodes(query), chainGetLength(query));
+}
+
+std::unique_ptr<SearchState> createSearchState(const std::string& path,
+    const std::string& parameters) {
+
+    auto state = std::unique_ptr<SearchState>(new SearchState(path, parameters));
+
+    std::string data;
+    if (!readFile(path, data) || data.compare(0, kMagicLength, kStateMagic) != 0) {
+        return state;
+    }
+
+    uint64_t i = kMagicLength;
+    uint32_t parameters_length = 0, database_length = 0, queries_length = 0;
+    uint64_t database_digest = 0, stop_words_digest = 0;
+    if (!readValue(data, i, parameters_length) || i + parameters_length > data.size() ||
+        data.compare(i, parameters_length, parameters) != 0) {
+        return state;
+    }
+    i += parameters_length;
+
+    if (!readValue(data, i, database_length) || !readValue(data, i, database_digest) ||
+        !readValue(data, i, stop_words_digest) || !readValue(data, i, queries_length)) {
+        return state;
+    }
+
+    std::unordered_map<std::string, std::vector<Candidate>> candidates;
+    for (uint32_t j = 0; j < queries_length; ++j) {
+        uint32_t key_length = 0, candidates_length = 0;
+        if (!readValue(data, i, key_length) || i + key_length > data.size()) {
+            return state;
+        }
+        std::string key = data.substr(i, key_length);
+        i += key_length;
+
+        if (!readValue(data, i, candidates_length)) {
+            return state;
+        }
+        auto& it = candidates[key];
+        for (uint32_t k = 0; k < candidates_length; ++k) {
+            int32_t id = 0;
+            float score = 0;
+            if (!readValue(data, i, id) || !readValue(data, i, score)) {
+                return state;
+            }
+            it.emplace_back(score, id);
+        }
+    }
+
+    state->database_length_ = database_length;
+    state->database_digest_ = database_digest;
+    state->stop_words_digest_ = stop_words_digest;
+    state->candidates_.swap(candidates);
+
+    return state;
+}
+
+SearchState::SearchState(const std::string& path, const std::string& parameters)
+        : path_(path), parameters_(parameters), database_length_(0), database_digest_(0),
+        stop_words_digest_(0), candidates_() {
+}
+
+bool SearchState::find(std::vector<Candidate>& dst, Chain* query) const {
+
+    auto it = candidates_.find(queryKey(query));
+    if (it == candidates_.end()) {
+        return false;
+    }
+
+    dst = it->second;
+    return true;
+}
+
+void SearchState::update(uint32_t database_length, uint64_t database_digest,
+    uint64_t stop_words_digest, Chain** queries,
+    int32_t queries_length, const std::vector<std::vector<Candidate>>& candidates) {
+
+    database_length_ = database_length;
+    database_digest_ = database_digest;
+    stop_words_digest_ = stop_words_digest;
+
+    candidates_.clear();
+    for (int32_t i = 0; i < queries_length; ++i) {
+        candidates_[queryKey(queries[i])] = candidates[i];
+    }
+}
+
+void SearchState::clear() {
+    database_length_ = 0;
+    database_digest_ = 0;
+    stop_words_digest_ = 0;
+    candidates_.clear();
+}
+
+void SearchState::store() const {
+
+    std::string data = kStateMagic;
+    appendValue<uint32_t>(data, parameters_.size());
+    data += parameters_;
+    appendValue<uint32_t>(data, database_length_);
+    appendValue<uint64_t>(data, database_digest_);
+    appendValue<uint64_t>(data, stop_words_digest_);
+    appendValue<uint32_t>(data, candidates_.size());
+
+    for (const auto& it: candidates_) {
+        appendValue<uint32_t>(data, it.first.size());
+        data += it.first;
+        appendValue<uint32_t>(data, it.second.size());
+        for (const auto& candidate: it.second) {
+            appendValue<int32_t>(data, candidate.id);
+            appendValue<float>(data, candidate.score);
+        }
+    }
+
+    replaceFile(path_, data);
+}
@@ -0,0 +1,84 @@
+/*!
+ * @file search_state.hpp
+ *
+ * @brief SearchState class header file
+ *
+ * @author: rvaser
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include "database_search.hpp"
+
+#include "swsharp/swsharp.h"
+
+class SearchState;
+
+/* loads the state stored in path, it is empty if the file does not exist or was created
+with different parameters, which should contain every option changing the candidates */
+std::unique_ptr<SearchState> createSearchState(const std::string& path,
+    const std::string& parameters);
+
+/*!
+ * @brief Scored candidates of each query of the last database search with the number
+ * and a digest of the database sequences they were searched in, which lets a search
+ * of the same database with sequences appended to it scan only the new sequences.
+ * Queries are identified by their sequences, the state holds only the queries of the
+ * last search.
+ */
+class SearchState {
+public:
+
+    ~SearchState() {};
+
+    /* number of database sequences searched */
+    uint32_t databaseLength() const {
+        return database_length_;
+    }
+
+    uint64_t databaseDigest() const {
+        return database_digest_;
+    }
+
+    /* digest of the stop words left out of the search, 0 if there were none */
+    uint64_t stopWordsDigest() const {
+        return stop_words_digest_;
+    }
+
+    /* returns false if the query is not in the state */
+    bool find(std::vector<Candidate>& dst, Chain* query) const;
+
+    /* replaces the state with the candidates of queries searched in the first
+    database_length sequences */
+    void update(uint32_t database_length, uint64_t database_digest,
+        uint64_t stop_words_digest, Chain** queries,
+        int32_t queries_length, const std::vector<std::vector<Candidate>>& candidates);
+
+    /* empties the state, e.g. if the searched sequences changed */
+    void clear();
+
+    void store() const;
+
+    friend std::unique_ptr<SearchState> createSearchState(const std::string& path,
+        const std::string& parameters);
+
+private:
+
+    SearchState(const std::string& path, const std::string& parameters);
+    SearchState(const SearchState&) = delete;
+    const SearchState& operator=(const SearchState&) = delete;
+
+    std::string path_;
+    std::string parameters_;
+    uint32_t database_length_;
+    uint64_t database_digest_;
+    uint64_t stop_words_digest_;
+    // candidates keyed by query residue codes
+    std::unordered_map<std::string, std::vector<Candidate>> candidates_;
+};
@@ -0,0 +1,86 @@
+/*!
+ * @file seg.cpp
+ *
+ * @brief Low-complexity masking source file
+ *
+ * @author: rvaser
+ */
+
+#include <math.h>
+
+#include "seg.hpp"
+
+constexpr uint32_t kAlphabetSize = 32;
+
+/* c * log2(c) for window counts */
+static const std::vector<double> kCountLogs = []() -> std::vector<double> {
+    std::vector<double> dst(kSegWindow + 1, 0);
+    for (uint32_t c = 1; c <= kSegWindow; ++c) {
+        dst[c] = c * log2((double) c);
+    }
+    return dst;
+}();
+
+uint32_t maskLowComplexity(std::vector<uint8_t>& dst, const char* codes, uint32_t length) {
+
+    dst.assign(length, 0);
+
+    if (length < kSegWindow) {
+        return 0;
+    }
+
+    // entropy of the window at i is log2(W) - sum / W
+    double max_entropy = log2((double) kSegWindow);
+
+    uint32_t counts[kAlphabetSize] = { 0 };
+    double sum = 0;
+
+    auto add = [&](char code, int32_t delta) -> void {
+        uint32_t& count = counts[(uint8_t) code & (kAlphabetSize - 1)];
+        sum -= kCountLogs[count];
+        count += delta;
+        sum += kCountLogs[count];
+    };
+
+    for (uint32_t i = 0; i < kSegWindow - 1; ++i) {
+        add(codes[i], 1);
+    }
+
+    uint32_t masked = 0;
+
+    // current run of windows below kSegExtension
+    int64_t run_begin = -1;
+    bool is_triggered = false;
+
+    auto close_run = [&](uint32_t run_end) -> void {
+        if (run_begin >= 0 && is_triggered) {
+            for (uint32_t j = run_begin; j < run_end + kSegWindow - 1; ++j) {
+                masked += dst[j] == 0;
+                dst[j] = 1;
+            }
+        }
+        run_begin = -1;
+        is_triggered = false;
+    };
+
+    for (uint32_t i = 0; i + kSegWindow <= length; ++i) {
+        if (i != 0) {
+            add(codes[i - 1], -1);
+        }
+        add(codes[i + kSegWindow - 1], 1);
+
+        double entropy = max_entropy - sum / kSegWindow;
+
+        if (entropy < kSegExtension) {
+            if (run_begin < 0) {
+                run_begin = i;
+            }
+            is_triggered |= entropy < kSegTrigger;
+        } else {
+            close_run(i);
+        }
+    }
+    close_run(length - kSegWindow + 1);
+
+    return masked;
+}
@@ -0,0 +1,24 @@
+/*!
+ * @file seg.hpp
+ *
+ * @brief Low-complexity masking header file
+ *
+ * @author: rvaser
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+/* SEG parameters (Wootton and Federhen): window length and Shannon entropies (in
+bits) below which a window triggers a low-complexity region and to which it is
+extended */
+constexpr uint32_t kSegWindow = 12;
+constexpr double kSegTrigger = 2.2;
+constexpr double kSegExtension = 2.5;
+
+/* sets dst[i] to 1 for residues of low-complexity regions of codes (values below 32),
+returns the number of masked residues; a region is a run of overlapping windows with
+entropy below kSegExtension containing at least one window below kSegTrigger */
+uint32_t maskLowComplexity(std::vector<uint8_t>& dst, const char* codes, uint32_t length);
@@ -8,123 +8,73 @@
 
 #include <math.h>
 #include <cstring>
-#include <fstream>
+#include <sstream>
 #include <algorithm>
 
 #include "utils.hpp"
 #include "constants.hpp"
 #include "select_alignments.hpp"
 
-class ThreadSelectionData {
-public:
-    ThreadSelectionData(std::vector<Chain*>& _dst, DbAlignment** _alignments, int _alignments_length,
-        Chain* _query, float _threshold):
-            dst(_dst), alignments(_alignments), alignments_length(_alignments_length),
-            query(_query), threshold(_threshold) {
-    }
-
-    std::vector<Chain*>& dst;
-    DbAlignment** alignments;
-    int alignments_length;
-    Chain* query;
-    float threshold;
-};
+/* maximal number of valid residues in a column for which entropy terms are tabulated */
+constexpr uint32_t kEntropyTableMaxValid = 2048;
 
 void aligmentStr(char** query_str, char** target_str, Alignment* alignment, const char gap_item);
 
-void alignmentsExtract(std::vector<Chain*>& dst, Chain* query, DbAlignment** alignments,
+void alignmentsExtract(Msa& dst, Chain* query, DbAlignment** alignments,
     int alignments_length);
 
-int alignmentsSelect(std::vector<Chain*>& alignment_strings, Chain* query, float threshold);
-
-void* threadSelectAlignments(void* params);
+int alignmentsSelect(const Msa& alignment_strings, float threshold);
 
 /*****************************************************************************
 *****************************************************************************/
 
-void selectAlignments(std::vector<std::vector<Chain*>>& dst, DbAlignment*** alignments,
-    int32_t* alignments_lengths, Chain** queries, int32_t queries_length,
-    float threshold) {
+std::unique_ptr<Msa> selectQueryAlignments(Chain* query, DbAlignment** alignments,
+    int alignments_length, float threshold) {
 
-    dst.resize(queries_length);
+    auto dst = createMsa(chainGetLength(query));
 
-    fprintf(stderr, "** Selecting alignments with median threshold: %.2f **\n", threshold);
+    alignmentsExtract(*dst, query, alignments, alignments_length);
 
-    std::vector<ThreadPoolTask*> thread_tasks(queries_length, nullptr);
+    uint32_t selected_alignments_length = alignmentsSelect(*dst, threshold);
 
-    for (int32_t i = 0; i < queries_length; ++i) {
+    dst->resize(selected_alignments_length);
 
-        if (alignments_lengths[i] == 0) {
-            continue;
-        }
-
-        auto thread_data = new ThreadSelectionData(dst[i], alignments[i],
-            alignments_lengths[i], queries[i], threshold);
-
-        thread_tasks[i] = threadPoolSubmit(threadSelectAlignments, (void*) thread_data);
-    }
-
-    for (int32_t i = 0; i < queries_length; ++i) {
-        threadPoolTaskWait(thread_tasks[i]);
-        threadPoolTaskDelete(thread_tasks[i]);
-        queryLog(i + 1, queries_length);
-    }
-
-    fprintf(stderr, "\n\n");
+    return dst;
 }
 
-void outputSelectedAlignments(std::vector<std::vector<Chain*>>& alignment_strings,
-    Chain** queries, int32_t queries_length, const std::string& out_path) {
+void printSelectedAlignments(const Msa* alignment_strings, Chain* query, std::string& dst) {
 
-    std::string out_extension = ".aligned.fasta";
+    std::ostringstream out_file;
 
-    for (uint32_t i = 0; i < alignment_strings.size(); ++i) {
+    int query_len = chainGetLength(query);
 
-        std::ofstream out_file;
-        char* out_file_name = createFileName(chainGetName(queries[i]), out_path, out_extension);
+    out_file << ">QUERY" << std::endl;
 
-        int query_len = chainGetLength(queries[i]);
+    for (int j = 1; j < query_len + 1; ++j) {
+        out_file << chainGetChar(query, j - 1);
+        if (j % 60 == 0) out_file << std::endl;
+    }
+    out_file << std::endl;
 
-        out_file.open(out_file_name);
-        out_file << ">QUERY" << std::endl;
+    uint32_t alignments_length = alignment_strings == nullptr ? 0 : alignment_strings->size();
+    for (uint32_t j = 0; j < alignments_length; ++j) {
+        out_file << ">" << alignment_strings->name(j) << std::endl;
 
-        for (int j = 1; j < query_len + 1; ++j) {
-            out_file << chainGetChar(queries[i], j - 1);
-            if (j % 60 == 0) out_file << std::endl;
+        const uint8_t* row = alignment_strings->row(j);
+        for (int k = 1; k < query_len + 1; ++k) {
+            out_file << msaDecode(row[k - 1]);
+            if (k % 60 == 0) out_file << std::endl;
         }
         out_file << std::endl;
-
-        for (uint32_t j = 0; j < alignment_strings[i].size(); ++j) {
-            out_file << ">" << chainGetName(alignment_strings[i][j]) << std::endl;
-
-            for (int k = 1; k < query_len + 1; ++k) {
-                out_file << chainGetChar(alignment_strings[i][j], k - 1);
-                if (k % 60 == 0) out_file << std::endl;
-            }
-            out_file << std::endl;
-        }
-
-        out_file.close();
-        delete[] out_file_name;
     }
-}
 
-void deleteSelectedAlignments(std::vector<std::vector<Chain*>>& alignment_strings) {
-    for (uint32_t i = 0; i < alignment_strings.size(); ++i) {
-        for (uint32_t j = 0; j < alignment_strings[i].size(); ++j) {
-            if (alignment_strings[i][j] != nullptr) {
-                chainDelete(alignment_strings[i][j]);
-                alignment_strings[i][j] = nullptr;
-            }
-        }
-        std::vector<Chain*>().swap(alignment_strings[i]);
-    }
+    dst += out_file.str();
 }
 
 /*****************************************************************************
 *****************************************************************************/
 
-void alignmentsExtract(std::vector<Chain*>& dst, Chain* query, DbAlignment** alignments,
+void alignmentsExtract(Msa& dst, Chain* query, DbAlignment** alignments,
     int alignments_length) {
 
 	int query_len = chainGetLength(query);
@@ -170,8 +120,7 @@ void alignmentsExtract(std::vector<Chain*>& dst, Chain* query, DbAlignment** ali
 			alignment_str[j] = 'X';
 		}
 
-        dst.push_back(chainCreate((char*) chainGetName(target), strlen(chainGetName(target)),
-            alignment_str, query_len));
+        dst.append(chainGetName(target), alignment_str);
 
         delete[] query_str;
         delete[] target_str;
@@ -180,65 +129,72 @@ void alignmentsExtract(std::vector<Chain*>& dst, Chain* query, DbAlignment** ali
     delete[] alignment_str;
 }
 
-int alignmentsSelect(std::vector<Chain*>& alignment_strings, Chain* query, float threshold) {
+int alignmentsSelect(const Msa& alignment_strings, float threshold) {
 
-	int amino_acid_num = 26;
-	float median = kLog_2_20;
+    int amino_acid_num = kMsaCodes;
+    float median = kLog_2_20;
 
-    int* amino_acid_nums = new int[amino_acid_num];
-	for (int i = 0; i < amino_acid_num; ++i) {
-		amino_acid_nums[i] = 0;
-	}
-
-	int query_len = chainGetLength(query);
+    int query_len = alignment_strings.length();
 
-    float* pos_freq = new float[query_len];
-	for (int i = 0; i < query_len; ++i) {
-		pos_freq[i] = 0.0;
-	}
+    /* amino acid counts over rows 0..i-1 for each position, updated when a row is added */
+    std::vector<uint32_t> amino_acid_nums(query_len * amino_acid_num, 0);
+    std::vector<uint32_t> valid(query_len, 0);
 
-	char c;
-	int i, valid;
-	for (i = 1; median > threshold && i <= (int) alignment_strings.size(); ++i) {
+    std::vector<float> pos_freq(query_len, 0.0);
+    for (int j = 0; j < query_len; ++j) {
+        pos_freq[j] += kLog_2_20;
+    }
+    std::vector<float> median_buffer(query_len);
+
+    /* entropy terms c / v * log2(c / v) for 0 < c <= v, stored for each v
+    in row v * (v - 1) / 2 (computed the same way as before so that the
+    selection does not change) */
+    std::vector<float> entropy_terms;
+    auto entropy_term = [&](uint32_t c, uint32_t v) -> float {
+        if (v <= kEntropyTableMaxValid) {
+            return entropy_terms[v * (v - 1) / 2 + c - 1];
+        }
+        return c / (float) v * log2f(c / (float) v);
+    };
 
-		for (int j = 0; j < query_len; ++j) {
-			valid = 0;
+    uint8_t c;
+    int i;
+    for (i = 1; median > threshold && i <= (int) alignment_strings.size(); ++i) {
 
-			for (int k = 0; k < i; ++k) {
-				c = chainGetChar(alignment_strings[k], j);
-				if (c != 'X') {
-					valid++;
-					amino_acid_nums[(int) c - 'A']++;
-				}
-			}
+        if (i <= (int) kEntropyTableMaxValid) {
+            for (int k = 1; k <= i; ++k) {
+                entropy_terms.emplace_back(k / (float) i * log2f(k / (float) i));
+            }
+        }
 
-			for (int k = 0; k < amino_acid_num; ++k) {
-				if (amino_acid_nums[k] != 0) {
-					pos_freq[j] += amino_acid_nums[k] / (float) valid *
-						log2f(amino_acid_nums[k] / (float) valid);
-				}
-			}
+        const uint8_t* row = alignment_strings.row(i - 1);
 
-			pos_freq[j] += kLog_2_20;
+        for (int j = 0; j < query_len; ++j) {
+            c = row[j];
+            if (c == kMsaX) {
+                continue;
+            }
 
-			for (int k = 0; k < amino_acid_num; ++k) {
-				if (amino_acid_nums[k] != 0) {
-					amino_acid_nums[k] = 0;
-				}
-			}
-		}
+            uint32_t* nums = &amino_acid_nums[j * amino_acid_num];
+            ++nums[c];
+            ++valid[j];
 
-		median = getMedian(pos_freq, query_len);
+            float freq = 0.0;
+            for (int k = 0; k < amino_acid_num; ++k) {
+                if (nums[k] != 0) {
+                    freq += entropy_term(nums[k], valid[j]);
+                }
+            }
 
-		for (int j = 0; j < query_len; ++j) {
-			pos_freq[j] = 0.0;
-		}
-	}
+            pos_freq[j] = freq;
+            pos_freq[j] += kLog_2_20;
+        }
 
-    delete[] pos_freq;
-    delete[] amino_acid_nums;
+        median_buffer.assign(pos_freq.begin(), pos_freq.end());
+        median = getMedian(median_buffer.data(), query_len);
+    }
 
-	return i - 1;
+    return i - 1;
 }
 
 void aligmentStr(char** query_str, char** target_str, Alignment* alignment, const char gap_item) {
@@ -299,24 +255,3 @@ void aligmentStr(char** query_str, char** target_str, Alignment* alignment, cons
     }
 }
 
-void* threadSelectAlignments(void* params) {
-
-    auto thread_data = (ThreadSelectionData*) params;
-
-    thread_data->dst.clear();
-
-    alignmentsExtract(thread_data->dst, thread_data->query, thread_data->alignments,
-        thread_data->alignments_length);
-
-    uint32_t selected_alignments_length = alignmentsSelect(thread_data->dst,
-        thread_data->query, thread_data->threshold);
-
-    for (uint32_t i = selected_alignments_length; i < thread_data->dst.size(); ++i) {
-        chainDelete(thread_data->dst[i]);
-    }
-    thread_data->dst.resize(selected_alignments_length);
-
-    delete thread_data;
-
-    return nullptr;
-}
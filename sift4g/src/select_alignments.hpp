@@ -12,13 +12,13 @@
 #include <vector>
 #include <string>
 
-#include "swsharp/swsharp.h"
+#include "msa.hpp"
 
-void selectAlignments(std::vector<std::vector<Chain*>>& dst, DbAlignment*** alignments,
-    int32_t* alignments_lengths, Chain** queries, int32_t queries_length,
-    float threshold);
+#include "swsharp/swsharp.h"
 
-void outputSelectedAlignments(std::vector<std::vector<Chain*>>& alignment_strings,
-    Chain** queries, int32_t queries_length, const std::string& out_path);
+/* extracts the alignments of one query and keeps the ones selected with the median threshold */
+std::unique_ptr<Msa> selectQueryAlignments(Chain* query, DbAlignment** alignments,
+    int alignments_length, float threshold);
 
-void deleteSelectedAlignments(std::vector<std::vector<Chain*>>& alignment_strings);
+/* appends the query and the selected alignments in FASTA format to dst */
+void printSelectedAlignments(const Msa* alignment_strings, Chain* query, std::string& dst);
@@ -0,0 +1,296 @@
+/*!
+ * @file server.cpp
+ *
+ * @brief Resident server source file
+ *
+ * @author: rvaser
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <algorithm>
+#include <unordered_set>
+
+#include "utils.hpp"
+#include "database_search.hpp"
+#include "database_clusters.hpp"
+#include "database_alignment.hpp"
+#include "sift_prediction.hpp"
+#include "sift4g.hpp"
+#include "server.hpp"
+
+#include "swsharp/evalue.h"
+#include "swsharp/swsharp.h"
+
+constexpr char kJobExtension[] = ".job";
+constexpr char kDoneExtension[] = ".done";
+constexpr char kFailedExtension[] = ".failed";
+
+/* pause between scans of an empty spool directory */
+constexpr useconds_t kSpoolPollInterval = 100000;
+
+/* finished jobs are renamed to <name>.<n>.done if <name>.done exists, up to this n */
+constexpr uint32_t kMaxFinishedCopies = 1000;
+
+/* query names are used for output file names, the longest extension has 14 characters */
+constexpr uint32_t kMaxQueryNameLength = 240;
+
+static volatile sig_atomic_t terminated = 0;
+
+class ServerJob {
+public:
+    std::string name;
+    std::string path;
+    Chain** queries;
+    int32_t queries_length;
+    std::vector<std::vector<Substitution>> substitutions;
+    std::vector<std::vector<uint32_t>> query_groups;
+    // index of the first group among the searched queries of the batch
+    uint32_t begin;
+};
+
+static void terminate(int) {
+    terminated = 1;
+}
+
+/* names of ready jobs without the extension, in lexicographic order, ignored jobs are
+left out */
+static void findJobs(std::vector<std::string>& dst, const std::string& spool_path,
+    const std::unordered_set<std::string>& ignored) {
+
+    dst.clear();
+
+    DIR* directory = opendir(spool_path.c_str());
+    ASSERT(directory, "unable to open directory '%s'", spool_path.c_str());
+
+    uint32_t extension_length = strlen(kJobExtension);
+
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != nullptr) {
+        uint32_t length = strlen(entry->d_name);
+        if (length > extension_length && strcmp(entry->d_name + length - extension_length, kJobExtension) == 0) {
+            std::string name(entry->d_name, length - extension_length);
+            if (ignored.count(name) == 0) {
+                dst.emplace_back(std::move(name));
+            }
+        }
+    }
+    closedir(directory);
+
+    std::sort(dst.begin(), dst.end());
+}
+
+/* renames the job directory to <name><extension> or, if a resubmitted job left that
+directory, to the first free <name>.<n><extension> */
+static bool renameJob(const ServerJob& job, const std::string& spool_path, const char* extension) {
+
+    for (uint32_t i = 0; i <= kMaxFinishedCopies; ++i) {
+        std::string finished_path = spool_path + "/" + job.name +
+            (i == 0 ? "" : "." + std::to_string(i)) + extension;
+        if (isExtantPath(finished_path.c_str()) != -1) {
+            continue;
+        }
+        if (rename(job.path.c_str(), finished_path.c_str()) == 0) {
+            return true;
+        }
+        // created in the meantime
+        if (errno != EEXIST && errno != ENOTEMPTY) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+/* jobs which can not be renamed are ignored until the server is restarted */
+static void finishJob(const ServerJob& job, const std::string& spool_path, bool is_done,
+    std::unordered_set<std::string>& ignored) {
+
+    if (!renameJob(job, spool_path, is_done ? kDoneExtension : kFailedExtension)) {
+        fprintf(stderr, "** Unable to rename job directory '%s' (%s), the job is ignored **\n\n",
+            job.path.c_str(), strerror(errno));
+        ignored.emplace(job.name);
+        return;
+    }
+
+    fprintf(stderr, "** Job [ %s ] %s **\n\n", job.name.c_str(), is_done ? "done" : "failed");
+}
+
+/* the job directory is written to and queries.fasta is read, neither may exit the server */
+static bool isAccessibleJob(const std::string& job_path, const char* queries_path) {
+    return isExtantPath(job_path.c_str()) == 0 && access(job_path.c_str(), R_OK | W_OK | X_OK) == 0 &&
+        isExtantPath(queries_path) == 1 && access(queries_path, R_OK) == 0;
+}
+
+/* query names are used as output file names */
+static bool hasValidNames(Chain** queries, int32_t queries_length) {
+    for (int32_t i = 0; i < queries_length; ++i) {
+        const char* name = chainGetName(queries[i]);
+        if (strchr(name, '/') != nullptr || strlen(name) > kMaxQueryNameLength) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void processJobs(const std::vector<std::string>& names, const std::string& spool_path,
+    const Sift4gDatabase& database, const std::vector<uint32_t>& representatives,
+    const std::map<uint32_t, std::vector<bool>>& stop_sets, Scorer* scorer,
+    EValueParams* evalue_params, const ServerOptions& options,
+    std::unordered_set<std::string>& ignored) {
+
+    std::vector<ServerJob> jobs;
+
+    for (const auto& it: names) {
+        ServerJob job;
+        job.name = it;
+        job.path = spool_path + "/" + it + kJobExtension;
+        job.queries = nullptr;
+        job.queries_length = 0;
+
+        char* queries_path = createFileName("queries", job.path, ".fasta");
+        if (isAccessibleJob(job.path, queries_path)) {
+            readFastaChains(&job.queries, &job.queries_length, queries_path);
+            if (hasValidNames(job.queries, job.queries_length)) {
+                checkData(job.queries, job.queries_length, job.path, job.substitutions);
+            } else {
+                fprintf(stderr, "** Job [ %s ] has invalid query names **\n", job.name.c_str());
+                deleteFastaChains(job.queries, job.queries_length);
+                job.queries = nullptr;
+                job.queries_length = 0;
+            }
+        }
+        delete[] queries_path;
+
+        if (job.queries_length == 0) {
+            free(job.queries);
+            finishJob(job, spool_path, false, ignored);
+            continue;
+        }
+
+        groupIdenticalQueries(job.query_groups, job.queries, job.queries_length);
+        jobs.emplace_back(std::move(job));
+    }
+
+    if (jobs.empty()) {
+        return;
+    }
+
+    // sequences shared by different jobs are searched and aligned once for each job
+    std::vector<Chain*> queries;
+    for (auto& job: jobs) {
+        job.begin = queries.size();
+        for (const auto& it: job.query_groups) {
+            queries.emplace_back(job.queries[it.front()]);
+        }
+    }
+
+    fprintf(stderr, "** Searching database and aligning %zu sequences of %zu jobs **\n\n",
+        queries.size(), jobs.size());
+
+    std::vector<std::vector<uint32_t>> indices;
+    searchDatabase(indices, database.chains(), database.length(), queries.data(), queries.size(),
+        options.kmer_length, options.max_candidates, options.num_threads, options.seg,
+        stop_sets, options.adaptive_search, representatives);
+
+    DbAlignment*** aligned = nullptr;
+    int* aligned_lengths = nullptr;
+
+    alignDatabase(&aligned, &aligned_lengths, database.chains(), database.length(), queries.data(),
+        queries.size(), indices, options.algorithm, evalue_params, options.max_evalue,
+        options.max_alignments, scorer, options.cards, options.cards_length);
+
+    for (auto& job: jobs) {
+
+        uint32_t groups_length = job.query_groups.size();
+
+        DbAlignment*** alignments = (DbAlignment***) malloc(groups_length * sizeof(DbAlignment**));
+        int* alignments_lengths = (int*) malloc(groups_length * sizeof(int));
+        for (uint32_t i = 0; i < groups_length; ++i) {
+            alignments[i] = aligned[job.begin + i];
+            alignments_lengths[i] = aligned_lengths[job.begin + i];
+        }
+
+        if (options.sub_results) {
+            char* alignments_path = createFileName("alignments", job.path, ".txt");
+            outputShotgunDatabase(alignments, alignments_lengths, groups_length, alignments_path,
+                options.out_format);
+            delete[] alignments_path;
+        }
+
+        std::vector<PredictionSettings> settings;
+        createPredictionSettings(settings, options.median_thresholds, options.sequence_identities,
+            job.path, options.archive, options.score_store);
+
+        siftPredictions(alignments, alignments_lengths, job.query_groups, job.queries,
+            job.substitutions, settings, options.sub_results, nullptr, std::vector<bool>(),
+            nullptr, nullptr);
+
+        deleteShotgunDatabase(alignments, alignments_lengths, groups_length);
+        deleteFastaChains(job.queries, job.queries_length);
+
+        finishJob(job, spool_path, true, ignored);
+    }
+
+    free(aligned);
+    free(aligned_lengths);
+}
+
+void serve(const std::string& spool_path, const std::string& database_path,
+    const ServerOptions& options) {
+
+    fprintf(stderr, "** Loading database **\n");
+
+    auto database = createSift4gDatabase(database_path);
+
+    fprintf(stderr, "** Loaded %d sequences (%llu residues) **\n\n", database->length(),
+        (unsigned long long) database->cells());
+
+    const std::vector<uint32_t> no_representatives;
+    const auto& representatives = options.collapse_duplicates ? database->representatives() :
+        no_representatives;
+    if (options.collapse_duplicates) {
+        fprintf(stderr, "** Searching %u representatives of identical sequences **\n\n",
+            countRepresentatives(representatives));
+    }
+
+    std::map<uint32_t, std::vector<bool>> stop_sets;
+    if (options.stop_words != 0) {
+        stop_sets = database->stopWords(searchKmerLengths(options.kmer_length,
+            options.adaptive_search), options.stop_words, options.seg);
+    }
+
+    Scorer* scorer = nullptr;
+    scorerCreateMatrix(&scorer, (char*) options.matrix.c_str(), options.gap_open, options.gap_extend);
+
+    EValueParams* evalue_params = createEValueParams(options.database_cells != 0 ?
+        options.database_cells : database->cells(), scorer);
+
+    signal(SIGINT, terminate);
+    signal(SIGTERM, terminate);
+
+    fprintf(stderr, "** Serving jobs from '%s' **\n\n", spool_path.c_str());
+
+    // a running batch is finished before terminating
+    std::vector<std::string> names;
+    std::unordered_set<std::string> ignored;
+    while (!terminated) {
+        findJobs(names, spool_path, ignored);
+        if (names.empty()) {
+            usleep(kSpoolPollInterval);
+            continue;
+        }
+        processJobs(names, spool_path, *database, representatives, stop_sets, scorer,
+            evalue_params, options, ignored);
+    }
+
+    fprintf(stderr, "** Terminating server **\n");
+
+    deleteEValueParams(evalue_params);
+    scorerDelete(scorer);
+}
@@ -0,0 +1,52 @@
+/*!
+ * @file server.hpp
+ *
+ * @brief Resident server header file
+ *
+ * @author: rvaser
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+/*!
+ * @brief Search, alignment and prediction options applied to every job.
+ */
+class ServerOptions {
+public:
+    uint32_t kmer_length;
+    uint32_t max_candidates;
+    int32_t gap_open;
+    int32_t gap_extend;
+    std::string matrix;
+    double max_evalue;
+    uint32_t max_alignments;
+    int32_t algorithm;
+    int32_t* cards;
+    int32_t cards_length;
+    std::vector<float> median_thresholds;
+    std::vector<int32_t> sequence_identities;
+    bool sub_results;
+    int32_t out_format;
+    bool archive;
+    bool score_store;
+    uint32_t num_threads;
+    // database size for e-value statistics, 0 for the size of the loaded database
+    uint64_t database_cells;
+    bool seg;
+    uint32_t stop_words;
+    bool collapse_duplicates;
+    bool adaptive_search;
+};
+
+/* loads the database once and processes jobs from the spool directory until SIGINT or
+SIGTERM is received; a job is a directory <name>.job holding queries.fasta and optional
+substitution files <query name>.subst, which clients create under another name and
+rename when complete; outputs are written into the job directory which is renamed to
+<name>.done (or <name>.failed if it holds no valid queries); jobs found in one scan of
+the spool directory are searched and aligned together */
+void serve(const std::string& spool_path, const std::string& database_path,
+    const ServerOptions& options);
@@ -0,0 +1,158 @@
+/*!
+ * @file sift4g.cpp
+ *
+ * @brief Library interface source file
+ *
+ * @author: rvaser
+ */
+
+#include <stdlib.h>
+
+#include "utils.hpp"
+#include "database_search.hpp"
+#include "database_clusters.hpp"
+#include "database_alignment.hpp"
+#include "query_schedule.hpp"
+#include "sift4g.hpp"
+
+#include "swsharp/evalue.h"
+
+std::unique_ptr<Sift4gDatabase> createSift4gDatabase(const std::string& path) {
+
+    ASSERT(isExtantPath(path.c_str()) == 1, "invalid database file path '%s'", path.c_str());
+
+    Chain** chains = nullptr;
+    int32_t length = 0;
+    readFastaChains(&chains, &length, path.c_str());
+
+    return std::unique_ptr<Sift4gDatabase>(new Sift4gDatabase(chains, length));
+}
+
+Sift4gDatabase::Sift4gDatabase(Chain** chains, int32_t length)
+        : chains_(chains), length_(length), cells_(0) {
+
+    for (int32_t i = 0; i < length_; ++i) {
+        cells_ += chainGetLength(chains_[i]);
+    }
+}
+
+Sift4gDatabase::~Sift4gDatabase() {
+    deleteFastaChains(chains_, length_);
+}
+
+const std::vector<uint32_t>& Sift4gDatabase::representatives() const {
+
+    std::call_once(representatives_flag_, [this]() -> void {
+        createChainClusters(representatives_, chains_, length_);
+    });
+
+    return representatives_;
+}
+
+std::map<uint32_t, std::vector<bool>> Sift4gDatabase::stopWords(
+    const std::vector<uint32_t>& kmer_lengths, uint32_t stop_words, bool seg) const {
+
+    std::lock_guard<std::mutex> lock(stop_words_mutex_);
+
+    auto& stop_sets = stop_words_[std::make_tuple(stop_words, seg)];
+    createStopWordSets(stop_sets, chains_, length_, kmer_lengths, stop_words, seg);
+
+    std::map<uint32_t, std::vector<bool>> dst;
+    for (const auto& it: kmer_lengths) {
+        dst[it] = stop_sets[it];
+    }
+
+    return dst;
+}
+
+void sift4gPredict(std::vector<PredictionResult>& dst, const Sift4gDatabase& database,
+    const std::vector<Sift4gQuery>& queries, const Sift4gOptions& options) {
+
+    dst.clear();
+    dst.resize(queries.size());
+
+    // queries with invalid substitutions are left out
+    std::vector<uint32_t> valid_indices;
+    std::vector<Chain*> valid_queries;
+    std::vector<std::vector<Substitution>> substitutions;
+
+    for (uint32_t i = 0; i < queries.size(); ++i) {
+        const auto& it = queries[i];
+        Chain* query = chainCreate((char*) it.name.c_str(), it.name.size(),
+            (char*) it.sequence.c_str(), it.sequence.size());
+
+        std::vector<Substitution> query_substitutions;
+        if (!it.substitutions.empty() && !parseSubstitutions(query_substitutions, it.substitutions, query)) {
+            chainDelete(query);
+            continue;
+        }
+
+        valid_indices.emplace_back(i);
+        valid_queries.emplace_back(query);
+        substitutions.emplace_back(std::move(query_substitutions));
+    }
+
+    if (valid_queries.empty()) {
+        return;
+    }
+
+    int32_t queries_length = valid_queries.size();
+
+    std::vector<std::vector<uint32_t>> query_groups;
+    groupIdenticalQueries(query_groups, valid_queries.data(), queries_length);
+
+    std::vector<Chain*> unique_queries;
+    for (const auto& it: query_groups) {
+        unique_queries.emplace_back(valid_queries[it.front()]);
+    }
+
+    const std::vector<uint32_t> no_representatives;
+    const auto& representatives = options.collapse_duplicates ? database.representatives() :
+        no_representatives;
+
+    std::map<uint32_t, std::vector<bool>> stop_sets;
+    if (options.stop_words != 0) {
+        stop_sets = database.stopWords(searchKmerLengths(options.kmer_length,
+            options.adaptive_search), options.stop_words, options.seg);
+    }
+
+    std::vector<std::vector<uint32_t>> indices;
+    searchDatabase(indices, database.chains(), database.length(), unique_queries.data(),
+        unique_queries.size(), options.kmer_length, options.max_candidates, options.num_threads,
+        options.seg, stop_sets, options.adaptive_search, representatives);
+
+    Scorer* scorer = nullptr;
+    scorerCreateMatrix(&scorer, (char*) options.matrix.c_str(), options.gap_open, options.gap_extend);
+
+    EValueParams* evalue_params = createEValueParams(options.database_cells != 0 ?
+        options.database_cells : database.cells(), scorer);
+
+    std::vector<int32_t> cards = options.cards;
+
+    DbAlignment*** alignments = nullptr;
+    int* alignments_lengths = nullptr;
+
+    alignDatabase(&alignments, &alignments_lengths, database.chains(), database.length(),
+        unique_queries.data(), unique_queries.size(), indices, options.algorithm, evalue_params,
+        options.max_evalue, options.max_alignments, scorer, cards.data(), cards.size());
+
+    std::vector<PredictionResult> results(queries_length);
+
+    std::vector<PredictionSettings> settings(1);
+    settings[0].threshold = options.median_threshold;
+    settings[0].sequence_identity = options.sequence_identity;
+    settings[0].results = &results;
+
+    siftPredictions(alignments, alignments_lengths, query_groups, valid_queries.data(),
+        substitutions, settings, false, nullptr, std::vector<bool>(), nullptr, nullptr);
+
+    deleteShotgunDatabase(alignments, alignments_lengths, query_groups.size());
+
+    deleteEValueParams(evalue_params);
+    scorerDelete(scorer);
+
+    for (int32_t i = 0; i < queries_length; ++i) {
+        chainDelete(valid_queries[i]);
+        dst[valid_indices[i]] = std::move(results[i]);
+    }
+}
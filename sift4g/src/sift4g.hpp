@@ -0,0 +1,124 @@
+/*!
+ * @file sift4g.hpp
+ *
+ * @brief Library interface header file
+ *
+ * @author: rvaser
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include "sift_prediction.hpp"
+
+#include "swsharp/swsharp.h"
+
+class Sift4gDatabase;
+
+/* reads the database into memory */
+std::unique_ptr<Sift4gDatabase> createSift4gDatabase(const std::string& path);
+
+/*!
+ * @brief Protein database loaded once and searched by any number of
+ * sift4gPredict calls. Clusters of identical sequences and stop words of
+ * each k-mer length are computed once and kept for later calls.
+ */
+class Sift4gDatabase {
+public:
+
+    ~Sift4gDatabase();
+
+    Chain** chains() const {
+        return chains_;
+    }
+
+    int32_t length() const {
+        return length_;
+    }
+
+    /* number of residues, used for e-value statistics */
+    uint64_t cells() const {
+        return cells_;
+    }
+
+    /* representative of each sequence (see database_clusters.hpp), clustered on first
+    use, can be called from multiple threads */
+    const std::vector<uint32_t>& representatives() const;
+
+    /* stop words of each of kmer_lengths (see createStopWordSets), counted on first use,
+    can be called from multiple threads */
+    std::map<uint32_t, std::vector<bool>> stopWords(const std::vector<uint32_t>& kmer_lengths,
+        uint32_t stop_words, bool seg) const;
+
+    friend std::unique_ptr<Sift4gDatabase> createSift4gDatabase(const std::string& path);
+
+private:
+
+    Sift4gDatabase(Chain** chains, int32_t length);
+    Sift4gDatabase(const Sift4gDatabase&) = delete;
+    const Sift4gDatabase& operator=(const Sift4gDatabase&) = delete;
+
+    Chain** chains_;
+    int32_t length_;
+    uint64_t cells_;
+    mutable std::once_flag representatives_flag_;
+    mutable std::vector<uint32_t> representatives_;
+    // stop words by number of stop words and seg
+    mutable std::mutex stop_words_mutex_;
+    mutable std::map<std::tuple<uint32_t, bool>, std::map<uint32_t, std::vector<bool>>> stop_words_;
+};
+
+/*!
+ * @brief Query protein with optional substitutions given as lines of a
+ * substitution file (e.g. 'A12G'), without them all positions are scored.
+ */
+class Sift4gQuery {
+public:
+    std::string name;
+    std::string sequence;
+    std::vector<std::string> substitutions;
+};
+
+/*!
+ * @brief Search, alignment and prediction options, defaults are equal to
+ * the ones of the command line tool.
+ */
+class Sift4gOptions {
+public:
+    uint32_t kmer_length = 5;
+    uint32_t max_candidates = 5000;
+    int32_t gap_open = 10;
+    int32_t gap_extend = 1;
+    std::string matrix = "BLOSUM_62";
+    double max_evalue = 0.0001;
+    uint32_t max_alignments = 400;
+    int32_t algorithm = SW_ALIGN;
+    std::vector<int32_t> cards;
+    float median_threshold = 2.75;
+    int32_t sequence_identity = 100;
+    uint32_t num_threads = 8;
+    // database size for e-value statistics, 0 for the size of the database
+    uint64_t database_cells = 0;
+    // masks low-complexity regions for database search (see seg.hpp)
+    bool seg = false;
+    // number of most frequent database k-mers left out of database search
+    uint32_t stop_words = 0;
+    // searches only the first of identical database sequences, its copies are aligned too
+    bool collapse_duplicates = false;
+    // groups queries by length with their own k-mer length and candidate budget
+    bool adaptive_search = false;
+};
+
+/* predicts the queries without touching the file system, dst is indexed like queries;
+queries with invalid substitutions or without selected alignments are not predicted
+(see PredictionResult); runs on the swsharp thread pool which has to be initialized
+with threadPoolInitialize beforehand */
+void sift4gPredict(std::vector<PredictionResult>& dst, const Sift4gDatabase& database,
+    const std::vector<Sift4gQuery>& queries, const Sift4gOptions& options);
@@ -9,87 +9,277 @@
 #include <stdio.h>
 #include <string.h>
 #include <fstream>
-#include <regex>
 #include <iostream>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
 
 #include "utils.hpp"
 #include "sift_scores.hpp"
+#include "select_alignments.hpp"
+#include "async_writer.hpp"
+#include "score_store.hpp"
+#include "alignment_cache.hpp"
 #include "sift_prediction.hpp"
 
 constexpr uint32_t kMaxSequences = 400;
 
+/* number of positions scored by one task */
+constexpr uint32_t kScoreTaskPositions = 512;
+
+/* minimal number of alignment cells (rows x positions) handled by one median sequence info task */
+constexpr uint64_t kMedianTaskCells = 1 << 22;
+
+/*!
+ * @brief Thread pool tasks spawned while predicting one query. Tasks never wait
+ * on each other, the query is done once the selection and every prediction added
+ * with add() call finish(), the main thread waits for all recorded tasks afterwards.
+ */
+class QueryTasks {
+public:
+    QueryTasks()
+            : unfinished_(1) {
+    }
+
+    void add(uint32_t predictions) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        unfinished_ += predictions;
+    }
+
+    void submit(void* (*function)(void*), void* params) {
+        // the submitted task can not finish the query before it is recorded
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.emplace_back(threadPoolSubmit(function, params));
+    }
+
+    void finish() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--unfinished_ == 0) {
+            condition_.notify_all();
+        }
+    }
+
+    void wait() {
+        std::vector<ThreadPoolTask*> tasks;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this]() { return unfinished_ == 0; });
+            tasks.swap(tasks_);
+        }
+        for (const auto& it: tasks) {
+            threadPoolTaskWait(it);
+            threadPoolTaskDelete(it);
+        }
+    }
+
+private:
+
+    QueryTasks(const QueryTasks&) = delete;
+    const QueryTasks& operator=(const QueryTasks&) = delete;
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    uint32_t unfinished_;
+    std::vector<ThreadPoolTask*> tasks_;
+};
+
+/* query whose predictions are written, queries with identical sequences share the
+ * alignments, weights and scores of one prediction */
+class PredictionOutput {
+public:
+    PredictionOutput(Chain* _query, uint32_t _query_index, const std::vector<Substitution>& _substitutions)
+            : query(_query), query_index(_query_index), substitutions(&_substitutions), result(nullptr) {
+    }
+
+    Chain* query;
+    uint32_t query_index;
+    const std::vector<Substitution>* substitutions;
+    // set if the prediction is kept in memory
+    PredictionResult* result;
+    std::vector<double> medianSeqInfoForPos;
+    std::string out_file_name;
+};
+
+/* writers of the outputs of one prediction setting */
+class SettingsWriters {
+public:
+    std::unique_ptr<AsyncWriter> writer;
+    std::unique_ptr<AsyncWriter> store_writer;
+};
+
+class ThreadSelectionData {
+public:
+    ThreadSelectionData(const std::vector<PredictionOutput>& _outputs, DbAlignment** _alignments,
+        int32_t& _alignments_length, const std::vector<PredictionSettings>& _settings,
+        const std::vector<SettingsWriters>& _writers, bool _sub_results, AlignmentCache* _cache,
+        bool _is_cached, uint8_t* _is_uncached, QueryTasks* _tasks, uint32_t _query_index,
+        QueryTimings* _timings)
+            : outputs(_outputs), query(outputs.front().query), alignments(_alignments),
+            alignments_length(_alignments_length), settings(_settings), writers(_writers),
+            sub_results(_sub_results), cache(_cache), is_cached(_is_cached), is_uncached(_is_uncached),
+            tasks(_tasks), query_index(_query_index), timings(_timings) {
+    }
+
+    std::vector<PredictionOutput> outputs;
+    Chain* query;
+    DbAlignment** alignments;
+    int32_t& alignments_length;
+    const std::vector<PredictionSettings>& settings;
+    const std::vector<SettingsWriters>& writers;
+    bool sub_results;
+    AlignmentCache* cache;
+    // selected alignments are loaded from the cache instead of stored to it
+    bool is_cached;
+    // set if a cached selection can not be loaded anymore
+    uint8_t* is_uncached;
+    QueryTasks* tasks;
+    uint32_t query_index;
+    QueryTimings* timings;
+};
+
 class ThreadPredictionData {
 public:
-    ThreadPredictionData(std::vector<Chain*>& _alignment_strings, Chain* _query, const std::string& _subst_path,
-        int32_t _sequence_identity, const std::string& _out_path)
-            : alignment_strings(_alignment_strings), query(_query), sequence_identity(_sequence_identity),
-            subst_path(_subst_path), out_path(_out_path) {
+    ThreadPredictionData(std::unique_ptr<Msa> _alignment, const std::vector<PredictionOutput>& _outputs,
+        int32_t _sequence_identity, const std::string& _out_path, const std::string& _completed_path,
+        AsyncWriter* _writer, AsyncWriter* _store_writer, QueryTasks* _tasks, uint32_t _query_index,
+        QueryTimings* _timings)
+            : alignment(std::move(_alignment)), outputs(_outputs), query(outputs.front().query),
+            sequence_identity(_sequence_identity), out_path(_out_path), completed_path(_completed_path),
+            writer(_writer), store_writer(_store_writer), tasks(_tasks), query_index(_query_index),
+            timings(_timings) {
     }
 
-    std::vector<Chain*>& alignment_strings;
+    std::unique_ptr<Msa> alignment;
+    std::vector<PredictionOutput> outputs;
     Chain* query;
     int32_t sequence_identity;
-    std::string subst_path;
     std::string out_path;
+    std::string completed_path;
+    AsyncWriter* writer;
+    AsyncWriter* store_writer;
+    QueryTasks* tasks;
+    uint32_t query_index;
+    QueryTimings* timings;
+};
+
+/* state of a query after sequence weighting, shared by its scoring and median
+ * sequence info tasks; the last task passes the outputs to the writer and deletes it */
+class PredictionData {
+public:
+    PredictionData(std::unique_ptr<Msa> _alignment, std::vector<PredictionOutput>&& _outputs,
+        int _total_seq, const std::string& _completed_path, AsyncWriter* _writer,
+        AsyncWriter* _store_writer, QueryTasks* _tasks, uint32_t _query_index, QueryTimings* _timings)
+            : alignment(std::move(_alignment)), alignment_string(*alignment), outputs(std::move(_outputs)),
+            query(outputs.front().query), seq_weighted_matrix(alignment_string.length()),
+            tot_weights_each_pos(alignment_string.length()), number_of_diff_aas(alignment_string.length()),
+            aas_stored(alignment_string.length()), SIFTscores(alignment_string.length()),
+            total_seq(_total_seq), completed_path(_completed_path), writer(_writer), store_writer(_store_writer), tasks(_tasks),
+            query_index(_query_index), timings(_timings), pending(0) {
+    }
+
+    std::unique_ptr<Msa> alignment;
+    const Msa& alignment_string;
+    std::vector<PredictionOutput> outputs;
+    Chain* query;
+    ScoreMatrix seq_weighted_matrix;
+    std::vector<double> tot_weights_each_pos;
+    std::vector<double> number_of_diff_aas;
+    std::vector<double> aas_stored;
+    ScoreMatrix SIFTscores;
+    // positions which are printed regardless of the query amino acid score
+    std::vector<bool> requested_positions;
+    // union of the median sequence info tables of all outputs, empty if none has substitutions
+    std::vector<double> medianSeqInfoForPos;
+    // median sequence info of all positions, calculated only for the score store
+    std::vector<double> store_median;
+    std::vector<MedianSeqInfoGroup> groups;
+    int total_seq;
+    std::string completed_path;
+    AsyncWriter* writer;
+    AsyncWriter* store_writer;
+    QueryTasks* tasks;
+    uint32_t query_index;
+    QueryTimings* timings;
+    std::atomic<uint32_t> pending;
 };
 
+class ThreadRangeData {
+public:
+    ThreadRangeData(PredictionData* _prediction_data, uint32_t _begin, uint32_t _end)
+            : prediction_data(_prediction_data), begin(_begin), end(_end) {
+    }
+
+    PredictionData* prediction_data;
+    uint32_t begin;
+    uint32_t end;
+};
+
+void* threadSelectQueryAlignments(void* params);
+
 void* threadSiftPredictions(void* params);
 
+void* threadSiftScores(void* params);
+
+void* threadMedianSeqInfo(void* params);
+
 /*****************************************************************************
 *****************************************************************************/
 
-void checkData(Chain** queries, int32_t& queries_length, const std::string& subst_path) {
+bool parseSubstitutions(std::vector<Substitution>& dst, const std::vector<std::string>& lines,
+    Chain* query) {
+
+    bool is_valid = true;
+    Substitution substitution;
+
+    uint32_t num_valid_lines = 0;
+    for (const auto& it: lines) {
+        if (parseSubstitution(it, substitution)) {
+            ++num_valid_lines;
+            char ref_aa = substitution.ref_aa;
+            int pos = substitution.pos;
+            if (pos < 0 || pos >= chainGetLength(query)) {
+                fprintf(stderr, "* skipping protein [ %s ]: substitution list has a position out of bounds (line: %s, query length = %d) *\n",
+                    chainGetName(query), it.c_str(), chainGetLength(query));
+                is_valid = false;
+                break;
+            }
+            if (chainGetChar(query, pos) != ref_aa) {
+                fprintf(stderr, "* skipping protein [ %s ]: substitution list assumes wrong amino acid at position %d (line: %s, query amino acid = %c) *\n",
+                    chainGetName(query), pos+1, it.c_str(), chainGetChar(query, pos));
+                is_valid = false;
+                break;
+            }
+            dst.emplace_back(substitution);
+        }
+    }
+
+    if (num_valid_lines == 0) {
+        fprintf(stderr, "* skipping protein [ %s ]: substitution list contains zero valid lines *\n", chainGetName(query));
+        is_valid = false;
+    }
+
+    return is_valid;
+}
+
+void checkData(Chain** queries, int32_t& queries_length, const std::string& subst_path,
+    std::vector<std::vector<Substitution>>& substitutions) {
 
-    auto read_subst_file = [](std::vector<std::string>& substitutions, const std::string& path) -> void {
+    auto read_subst_file = [](std::vector<std::string>& lines, const std::string& path) -> void {
         std::ifstream infile(path);
         std::string line;
         if (infile.good()) {
             while (std::getline(infile, line)) {
-                substitutions.push_back(line);
+                lines.push_back(line);
             }
         }
         infile.close();
         return;
     };
 
-    auto check_substitutions = [](const std::vector<std::string>& substitutions, Chain* chain) -> bool {
-
-        bool is_valid = true;
-        std::regex regex_subst("^([A-Z])([0-9]+)([A-Z])");  /*, std::regex_constants::basic); */
-        std::smatch m;
-
-        uint32_t num_valid_lines = 0;
-        for (const auto& it: substitutions) {
-            if (regex_search(it, m, regex_subst)) {
-                ++num_valid_lines;
-                char ref_aa = std::string(m[1])[0];
-                int pos = stoi(std::string(m[2])) - 1;
-                if (pos >= chainGetLength(chain)) {
-                    fprintf(stderr, "* skipping protein [ %s ]: substitution list has a position out of bounds (line: %s, query length = %d) *\n",
-                        chainGetName(chain), it.c_str(), chainGetLength(chain));
-                    is_valid = false;
-                    break;
-                }
-                if (chainGetChar(chain, pos) != ref_aa) {
-                    fprintf(stderr, "* skipping protein [ %s ]: substitution list assumes wrong amino acid at position %d (line: %s, query amino acid = %c) *\n",
-                        chainGetName(chain), pos+1, it.c_str(), chainGetChar(chain, pos));
-                    is_valid = false;
-                    break;
-                }
-            }
-        }
-
-
-        if (num_valid_lines == 0) {
-            fprintf(stderr, "* skipping protein [ %s ]: substitution list contains zero valid lines *\n", chainGetName(chain));
-            is_valid = false;
-        }
-
-        return is_valid;
-    };
-
     std::string subst_extension = ".subst";
     std::vector<bool> is_valid_chain(queries_length, true);
+    substitutions.assign(queries_length, std::vector<Substitution>());
     bool shrink = false;
 
     fprintf(stderr, "** Checking query data and substitutions files **\n");
@@ -99,9 +289,10 @@ void checkData(Chain** queries, int32_t& queries_length, const std::string& subs
         char* subst_file_name = createFileName(chainGetName(queries[i]), subst_path, subst_extension);
 
         if (isExtantPath(subst_file_name) == 1) {
-            std::vector<std::string> substitutions;
-            read_subst_file(substitutions, subst_file_name);
-            if (check_substitutions(substitutions, queries[i]) == false) {
+            std::vector<std::string> lines;
+            read_subst_file(lines, subst_file_name);
+            if (parseSubstitutions(substitutions[i], lines, queries[i]) == false) {
+                std::vector<Substitution>().swap(substitutions[i]);
                 chainDelete(queries[i]);
                 queries[i] = nullptr;
                 is_valid_chain[i] = false;
@@ -129,6 +320,7 @@ void checkData(Chain** queries, int32_t& queries_length, const std::string& subs
                 break;
             } else if (i != j) {
                 queries[i] = queries[j];
+                substitutions[i].swap(substitutions[j]);
                 is_valid_chain[i] = true;
                 is_valid_chain[j] = false;
             }
@@ -136,107 +328,546 @@ void checkData(Chain** queries, int32_t& queries_length, const std::string& subs
         if (i < queries_length) {
             queries_length = i;
         }
+        substitutions.resize(queries_length);
     }
 
     fprintf(stderr, "\n\n");
 }
 
-void siftPredictions(std::vector<std::vector<Chain*>>& alignment_strings,
-    Chain** queries, int32_t queries_length, const std::string& subst_path,
-    int32_t sequence_identity, const std::string& out_path) {
+void createPredictionSettings(std::vector<PredictionSettings>& dst,
+    const std::vector<float>& median_thresholds, const std::vector<int32_t>& sequence_identities,
+    const std::string& out_path, bool archive, bool score_store) {
+
+    dst.clear();
+
+    for (const auto& threshold: median_thresholds) {
+        for (const auto& sequence_identity: sequence_identities) {
+            PredictionSettings it;
+            it.threshold = threshold;
+            it.sequence_identity = sequence_identity;
+            it.out_path = out_path;
+
+            if (median_thresholds.size() * sequence_identities.size() > 1) {
+                char name[64];
+                snprintf(name, sizeof(name), "threshold_%g_seq_id_%d", threshold, sequence_identity);
+                char* settings_path = createFileName(name, out_path, "");
+                it.out_path = settings_path;
+                delete[] settings_path;
+                createDirectory(it.out_path);
+            }
 
-    fprintf(stderr, "** Generating SIFT predictions with sequence identity: %.2f%% **\n", (float) sequence_identity);
+            if (archive) {
+                char* archive_file_name = createFileName("results", it.out_path, ".s4g");
+                it.archive_path = archive_file_name;
+                delete[] archive_file_name;
+            }
 
-    std::vector<ThreadPoolTask*> thread_tasks(queries_length, nullptr);
+            if (score_store) {
+                char* store_file_name = createFileName("scores", it.out_path, ".s4gs");
+                it.store_path = store_file_name;
+                delete[] store_file_name;
+            }
 
-    for (int32_t i = 0; i < queries_length; ++i) {
+            dst.emplace_back(it);
+        }
+    }
+}
 
-        if (alignment_strings[i].empty()) {
-            continue;
+void siftPredictions(DbAlignment*** alignments, int32_t* alignments_lengths,
+    const std::vector<std::vector<uint32_t>>& query_groups, Chain** queries,
+    std::vector<std::vector<Substitution>>& substitutions, const std::vector<PredictionSettings>& settings,
+    bool sub_results, AlignmentCache* cache, const std::vector<bool>& cached_groups,
+    QueryTimings* timings, const std::function<void(const std::vector<uint32_t>&)>& align_groups) {
+
+    if (settings.size() == 1) {
+        fprintf(stderr, "** Selecting alignments with median threshold: %.2f and generating SIFT predictions "
+            "with sequence identity: %.2f%% **\n", settings[0].threshold, (float) settings[0].sequence_identity);
+    } else {
+        fprintf(stderr, "** Selecting alignments and generating SIFT predictions for %zu combinations "
+            "of median threshold and sequence identity **\n", settings.size());
+    }
+
+    uint32_t groups_length = query_groups.size();
+
+    // selection is linear in the number of alignments, prediction uses at most kMaxSequences of them
+    std::vector<uint64_t> costs(groups_length);
+    for (uint32_t i = 0; i < groups_length; ++i) {
+        costs[i] = chainGetLength(queries[query_groups[i].front()]) * (uint64_t) (alignments_lengths[i] +
+            std::min<uint32_t>(alignments_lengths[i] + 1, kMaxSequences));
+    }
+    std::vector<uint32_t> order = scheduleQueries(costs);
+
+    std::vector<SettingsWriters> writers(settings.size());
+    for (uint32_t i = 0; i < settings.size(); ++i) {
+        writers[i].writer = createAsyncWriter(settings[i].archive_path);
+        if (!settings[i].store_path.empty()) {
+            writers[i].store_writer = createAsyncWriter(settings[i].store_path);
+        }
+    }
+
+    std::vector<std::unique_ptr<QueryTasks>> query_tasks(groups_length);
+    std::vector<uint8_t> is_uncached(groups_length, 0);
+
+    auto submit = [&](uint32_t i, bool is_cached) -> void {
+
+        query_tasks[i].reset(new QueryTasks());
+
+        std::vector<PredictionOutput> outputs;
+        for (const auto& j: query_groups[i]) {
+            outputs.emplace_back(queries[j], j, substitutions[j]);
         }
 
-        auto thread_data = new ThreadPredictionData(alignment_strings[i], queries[i],
-            subst_path, sequence_identity, out_path);
+        auto thread_data = new ThreadSelectionData(outputs, alignments[i], alignments_lengths[i],
+            settings, writers, sub_results, cache, is_cached, &is_uncached[i], query_tasks[i].get(),
+            query_groups[i].front(), timings);
+
+        query_tasks[i]->submit(threadSelectQueryAlignments, (void*) thread_data);
+    };
+
+    for (const auto& i: order) {
+        submit(i, cache != nullptr && cached_groups[i]);
+    }
 
-        thread_tasks[i] = threadPoolSubmit(threadSiftPredictions, (void*) thread_data);
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        query_tasks[order[i]]->wait();
+        queryLog(i + 1, groups_length);
     }
 
-    for (int32_t i = 0; i < queries_length; ++i) {
-        threadPoolTaskWait(thread_tasks[i]);
-        threadPoolTaskDelete(thread_tasks[i]);
-        queryLog(i + 1, queries_length);
+    // cache entries can change or disappear after they were found, nothing was written
+    // for such groups and they are searched, aligned and selected again
+    std::vector<uint32_t> uncached_groups;
+    for (const auto& i: order) {
+        if (is_uncached[i]) {
+            uncached_groups.emplace_back(i);
+        }
+    }
+
+    if (!uncached_groups.empty()) {
+        fprintf(stderr, "\n\n** Cache entries of %zu sequences changed during the run, "
+            "searching and aligning them again **\n\n", uncached_groups.size());
+
+        align_groups(uncached_groups);
+
+        for (const auto& i: uncached_groups) {
+            submit(i, false);
+        }
+
+        for (uint32_t i = 0; i < uncached_groups.size(); ++i) {
+            query_tasks[uncached_groups[i]]->wait();
+            queryLog(i + 1, uncached_groups.size());
+        }
     }
 
+    // returns after all files are written
+    writers.clear();
+
     fprintf(stderr, "\n\n");
 }
 
 /*****************************************************************************
 *****************************************************************************/
 
+/* runs the first range in the calling task and submits the others, the task
+ * finishing the last range continues with the next stage of the query */
+void submitRanges(PredictionData* prediction_data, const std::vector<std::pair<uint32_t, uint32_t>>& ranges,
+    void* (*function)(void*)) {
+
+    prediction_data->pending = ranges.size();
+    for (uint32_t i = 1; i < ranges.size(); ++i) {
+        auto thread_data = new ThreadRangeData(prediction_data, ranges[i].first, ranges[i].second);
+        prediction_data->tasks->submit(function, (void*) thread_data);
+    }
+    function((void*) new ThreadRangeData(prediction_data, ranges[0].first, ranges[0].second));
+}
+
+void finishPrediction(PredictionData* prediction_data) {
+
+    auto tasks = prediction_data->tasks;
+    delete prediction_data;
+    tasks->finish();
+}
+
+void outputPrediction(PredictionData* prediction_data) {
+
+    uint64_t begin = timerNow();
+
+    std::string record;
+    if (prediction_data->store_writer != nullptr) {
+        printScoreStoreRecord(prediction_data->SIFTscores, prediction_data->store_median,
+            prediction_data->aas_stored, prediction_data->total_seq, record);
+    }
+
+    for (auto& it: prediction_data->outputs) {
+        std::string data;
+        if (it.substitutions->empty()) {
+            // printMatrix(SIFTscores, out_file_name);
+            printMatrixOriginalFormat(prediction_data->SIFTscores, data);
+        } else {
+            printSubstFile(*it.substitutions, it.medianSeqInfoForPos, prediction_data->SIFTscores,
+                prediction_data->aas_stored, prediction_data->total_seq, it.query, data);
+        }
+        if (it.result != nullptr) {
+            const auto& scores = prediction_data->SIFTscores;
+            it.result->is_predicted = true;
+            it.result->scores = ScoreMatrix(scores.length());
+            for (uint32_t pos = 0; pos < scores.length(); ++pos) {
+                std::copy(scores[pos], scores[pos] + kMatrixWidth, it.result->scores[pos]);
+            }
+            it.result->total_seq = prediction_data->total_seq;
+            it.result->prediction = std::move(data);
+        } else {
+            prediction_data->writer->write(it.out_file_name, std::move(data));
+        }
+
+        if (prediction_data->store_writer != nullptr) {
+            prediction_data->store_writer->add(chainGetName(it.query), std::string(record));
+        }
+    }
+
+    // files are written in order, the line is appended after all of them
+    if (!prediction_data->completed_path.empty()) {
+        prediction_data->writer->append(prediction_data->completed_path,
+            completedLine(prediction_data->query_index, prediction_data->query));
+    }
+
+    queryTimingsAdd(prediction_data->timings, prediction_data->query_index, kStageOutput, begin);
+}
+
+void writeOutput(AsyncWriter* writer, Chain* query, const std::string& out_path,
+    const std::string& out_extension, std::string&& data) {
+
+    char* out_file_name = createFileName(chainGetName(query), out_path, out_extension);
+    writer->write(out_file_name, std::move(data));
+    delete[] out_file_name;
+}
+
+void* threadSelectQueryAlignments(void* params) {
+
+    auto thread_data = (ThreadSelectionData*) params;
+    const auto& settings = thread_data->settings;
+
+    std::vector<ThreadPredictionData*> predictions;
+    std::unique_ptr<Msa> alignment;
+
+    // cached selections of all thresholds are loaded before anything is written, so that
+    // a query whose entry can not be loaded anymore can be processed again from scratch
+    std::vector<std::unique_ptr<Msa>> cached_alignments;
+    if (thread_data->is_cached) {
+        uint64_t begin = timerNow();
+
+        for (uint32_t i = 0; i < settings.size(); ++i) {
+            if (i == 0 || settings[i].threshold != settings[i - 1].threshold) {
+                cached_alignments.emplace_back(thread_data->cache->load(thread_data->query,
+                    settings[i].threshold));
+                if (cached_alignments.back() == nullptr) {
+                    *thread_data->is_uncached = 1;
+                    break;
+                }
+            }
+        }
+
+        queryTimingsAdd(thread_data->timings, thread_data->query_index, kStageSelection, begin);
+
+        if (*thread_data->is_uncached) {
+            auto tasks = thread_data->tasks;
+            delete thread_data;
+            tasks->finish();
+            return nullptr;
+        }
+    }
+    uint32_t cached_index = 0;
+
+    // settings are ordered by threshold, settings with equal thresholds share the selection
+    for (uint32_t i = 0; i < settings.size(); ++i) {
+
+        float threshold = settings[i].threshold;
+
+        if (i == 0 || threshold != settings[i - 1].threshold) {
+            uint64_t begin = timerNow();
+
+            if (thread_data->is_cached) {
+                alignment = std::move(cached_alignments[cached_index++]);
+            } else {
+                alignment = nullptr;
+                if (thread_data->alignments_length > 0) {
+                    alignment = selectQueryAlignments(thread_data->query, thread_data->alignments,
+                        thread_data->alignments_length, threshold);
+                }
+                // queries without alignments are stored as well
+                if (thread_data->cache != nullptr) {
+                    thread_data->cache->store(thread_data->query, threshold, alignment.get());
+                }
+            }
+
+            queryTimingsAdd(thread_data->timings, thread_data->query_index, kStageSelection, begin);
+        }
+
+        AsyncWriter* writer = thread_data->writers[i].writer.get();
+
+        if (thread_data->sub_results) {
+            uint64_t begin = timerNow();
+            for (const auto& it: thread_data->outputs) {
+                std::string data;
+                printSelectedAlignments(alignment.get(), it.query, data);
+                writeOutput(writer, it.query, settings[i].out_path, ".aligned.fasta", std::move(data));
+            }
+            queryTimingsAdd(thread_data->timings, thread_data->query_index, kStageOutput, begin);
+        }
+
+        if (alignment == nullptr || alignment->size() == 0) {
+            if (!settings[i].completed_path.empty()) {
+                writer->append(settings[i].completed_path, completedLine(thread_data->query_index,
+                    thread_data->query));
+            }
+            continue;
+        }
+
+        // the last setting with this threshold takes the selection, the others a copy
+        bool is_last = i + 1 == settings.size() || settings[i + 1].threshold != threshold;
+
+        std::unique_ptr<Msa> prediction_alignment;
+        if (is_last) {
+            prediction_alignment = std::move(alignment);
+        } else {
+            std::vector<uint32_t> rows(alignment->size());
+            for (uint32_t j = 0; j < rows.size(); ++j) {
+                rows[j] = j;
+            }
+            prediction_alignment = alignment->subset(rows);
+        }
+
+        auto outputs = thread_data->outputs;
+        if (settings[i].results != nullptr) {
+            for (auto& it: outputs) {
+                it.result = &(*settings[i].results)[it.query_index];
+            }
+        }
+
+        predictions.emplace_back(new ThreadPredictionData(std::move(prediction_alignment),
+            outputs, settings[i].sequence_identity, settings[i].out_path,
+            settings[i].completed_path, writer, thread_data->writers[i].store_writer.get(),
+            thread_data->tasks, thread_data->query_index, thread_data->timings));
+    }
+
+    // alignments are no longer needed, deleteShotgunDatabase frees only the arrays
+    for (int32_t i = 0; i < thread_data->alignments_length; ++i) {
+        dbAlignmentDelete(thread_data->alignments[i]);
+    }
+    thread_data->alignments_length = 0;
+
+    auto tasks = thread_data->tasks;
+    delete thread_data;
+
+    // runs the last prediction in this task
+    tasks->add(predictions.size());
+    for (uint32_t i = 0; i + 1 < predictions.size(); ++i) {
+        tasks->submit(threadSiftPredictions, (void*) predictions[i]);
+    }
+    if (!predictions.empty()) {
+        threadSiftPredictions((void*) predictions.back());
+    }
+
+    tasks->finish();
+
+    return nullptr;
+}
+
 void* threadSiftPredictions(void* params) {
 
     auto thread_data = (ThreadPredictionData*) params;
 
-    std::string subst_extension = ".subst";
+    uint64_t begin = timerNow();
+
     std::string out_extension = ".SIFTprediction";
 
+    Msa& alignment_strings = *(thread_data->alignment);
+
     // only keep first 399 hits, erase more distant ones
-    if (thread_data->alignment_strings.size() > kMaxSequences - 1) {
-        for (uint32_t j = kMaxSequences - 1; j < thread_data->alignment_strings.size(); ++j) {
-            chainDelete(thread_data->alignment_strings[j]);
-        }
-        thread_data->alignment_strings.resize(kMaxSequences - 1);
-    }
+    alignment_strings.resize(kMaxSequences - 1);
 
     int query_length = chainGetLength(thread_data->query);
     remove_seqs_percent_identical_to_query(thread_data->query,
-        thread_data->alignment_strings, thread_data->sequence_identity);
+        alignment_strings, thread_data->sequence_identity);
 
     // add query sequence to the beginning of the alignment
-    thread_data->alignment_strings.insert(thread_data->alignment_strings.begin(),
-        chainCreateView(thread_data->query, 0, query_length - 1, 0));
-    int total_seq = thread_data->alignment_strings.size();
+    std::string query_str(query_length, 'X');
+    for (int i = 0; i < query_length; ++i) {
+        query_str[i] = chainGetChar(thread_data->query, i);
+    }
+    alignment_strings.insert(0, chainGetName(thread_data->query), query_str.c_str());
+    alignment_strings.transpose();
 
-    std::vector<std::vector<double>> matrix(query_length, std::vector<double>(26, 0.0));
-    std::vector<std::vector<double>> SIFTscores(query_length, std::vector<double>(26, 0.0));
+    int total_seq = alignment_strings.size();
+
+    for (auto& it: thread_data->outputs) {
+        char* out_file_name = createFileName(chainGetName(it.query), thread_data->out_path, out_extension);
+        it.out_file_name = out_file_name;
+        delete[] out_file_name;
+    }
 
-    std::vector<double> weights_1(thread_data->alignment_strings.size(), 1.0);
-    std::vector<double> aas_stored(query_length, 0.0);
+    auto prediction_data = new PredictionData(std::move(thread_data->alignment), std::move(thread_data->outputs),
+        total_seq, thread_data->completed_path, thread_data->writer, thread_data->store_writer,
+        thread_data->tasks, thread_data->query_index, thread_data->timings);
 
-    createMatrix(thread_data->alignment_strings, thread_data->query, weights_1, matrix, aas_stored);
+    // checkData leaves substitutions empty for queries without a substitution file
+    for (auto& it: prediction_data->outputs) {
+        if (it.substitutions->empty()) {
+            continue;
+        }
+        it.medianSeqInfoForPos.resize(query_length, kMedianSeqInfoAbsent);
+        hashPredictedPos(*it.substitutions, it.medianSeqInfoForPos);
+
+        auto& medianSeqInfoForPos = prediction_data->medianSeqInfoForPos;
+        medianSeqInfoForPos.resize(query_length, kMedianSeqInfoAbsent);
+        for (int pos = 0; pos < query_length; ++pos) {
+            if (it.medianSeqInfoForPos[pos] == kMedianSeqInfoRequested) {
+                medianSeqInfoForPos[pos] = kMedianSeqInfoRequested;
+            }
+        }
+    }
 
-    calcSIFTScores(thread_data->alignment_strings, thread_data->query, matrix, SIFTscores);
+    if (!prediction_data->medianSeqInfoForPos.empty()) {
+        prediction_data->requested_positions.resize(query_length);
+        for (int pos = 0; pos < query_length; ++pos) {
+            prediction_data->requested_positions[pos] =
+                prediction_data->medianSeqInfoForPos[pos] == kMedianSeqInfoRequested;
+        }
+    }
 
-    int num_seqs_in_alignment = thread_data->alignment_strings.size();
-    std::vector <double> seq_weights (num_seqs_in_alignment);
-    std::vector <double> number_of_diff_aas (query_length);
-    calcSeqWeights(thread_data->alignment_strings, matrix, aas_stored, seq_weights, number_of_diff_aas);
+    /* raw counts of valid amino acids */
+    ScoreMatrix matrix(query_length);
+    calcSeqWeights(alignment_strings, matrix, prediction_data->aas_stored,
+        prediction_data->number_of_diff_aas);
 
-    char* subst_file_name = createFileName(chainGetName(thread_data->query),
-        thread_data->subst_path, subst_extension);
-    char* out_file_name = createFileName(chainGetName(thread_data->query),
-        thread_data->out_path, out_extension);
+    /* now construct matrix with weighted sequence values */
+    createMatrix(alignment_strings, true, prediction_data->seq_weighted_matrix,
+        prediction_data->tot_weights_each_pos);
 
-    if (isExtantPath(subst_file_name) == 1) {
-        std::list<std::string> subst_list;
-        std::unordered_map<std::string, double> medianSeqInfoForPos;
+    queryTimingsAdd(prediction_data->timings, prediction_data->query_index, kStageWeighting, begin);
 
-        readSubstFile(subst_file_name, subst_list);
-        hashPredictedPos(subst_list, medianSeqInfoForPos);
-        addPosWithDelRef(thread_data->query, SIFTscores, medianSeqInfoForPos);
-        addMedianSeqInfo(thread_data->alignment_strings, thread_data->query,
-            matrix, medianSeqInfoForPos);
-        printSubstFile(subst_list, medianSeqInfoForPos, SIFTscores, aas_stored,
-            total_seq, thread_data->query, out_file_name);
-    } else {
-        // printMatrix(SIFTscores, out_file_name);
-        printMatrixOriginalFormat(SIFTscores, out_file_name);
+    delete thread_data;
+
+    // positions are scored independently of each other
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    for (int begin = 0; begin < query_length; begin += kScoreTaskPositions) {
+        ranges.emplace_back(begin, std::min<uint32_t>(begin + kScoreTaskPositions, query_length));
     }
+    if (ranges.empty()) {
+        ranges.emplace_back(0, 0);
+    }
+    submitRanges(prediction_data, ranges, threadSiftScores);
 
-    delete[] out_file_name;
-    delete[] subst_file_name;
+    return nullptr;
+}
+
+void* threadSiftScores(void* params) {
+
+    auto thread_data = (ThreadRangeData*) params;
+    auto prediction_data = thread_data->prediction_data;
+
+    uint64_t begin = timerNow();
+
+    const auto& outputs = prediction_data->outputs;
+    bool has_subst = !prediction_data->medianSeqInfoForPos.empty();
+    bool has_store = prediction_data->store_writer != nullptr;
+
+    // score matrix outputs and the score store need exact scores of all positions
+    bool all_subst = std::all_of(outputs.begin(), outputs.end(),
+        [](const PredictionOutput& it) -> bool { return !it.substitutions->empty(); });
+
+    calcSIFTScores(prediction_data->alignment_string, prediction_data->seq_weighted_matrix,
+        prediction_data->tot_weights_each_pos, prediction_data->number_of_diff_aas,
+        prediction_data->SIFTscores, all_subst && !has_store ? &prediction_data->requested_positions : nullptr,
+        thread_data->begin, thread_data->end);
+
+    queryTimingsAdd(prediction_data->timings, prediction_data->query_index, kStageScoring, begin);
 
     delete thread_data;
 
+    if (--prediction_data->pending != 0) {
+        return nullptr;
+    }
+
+    if (!has_subst && !has_store) {
+        outputPrediction(prediction_data);
+        finishPrediction(prediction_data);
+        return nullptr;
+    }
+
+    begin = timerNow();
+
+    if (has_subst) {
+        addPosWithDelRef(prediction_data->query, prediction_data->SIFTscores,
+            prediction_data->medianSeqInfoForPos);
+        for (auto& it: prediction_data->outputs) {
+            if (!it.substitutions->empty()) {
+                addPosWithDelRef(it.query, prediction_data->SIFTscores, it.medianSeqInfoForPos);
+            }
+        }
+    }
+
+    // medians of positions needed by each output are copied from the store medians
+    if (has_store) {
+        prediction_data->store_median.assign(prediction_data->SIFTscores.length(), kMedianSeqInfoRequested);
+    }
+    createMedianSeqInfoGroups(prediction_data->alignment_string, has_store ?
+        prediction_data->store_median : prediction_data->medianSeqInfoForPos, prediction_data->groups);
+
+    // split groups into tasks of roughly kMedianTaskCells alignment cells
+    const auto& groups = prediction_data->groups;
+    uint64_t query_length = prediction_data->alignment_string.length();
+
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    uint32_t first = 0;
+    uint64_t cells = 0;
+    for (uint32_t i = 0; i < groups.size(); ++i) {
+        cells += (groups[i].rows.size() + 1) * query_length;
+        if (cells >= kMedianTaskCells) {
+            ranges.emplace_back(first, i + 1);
+            first = i + 1;
+            cells = 0;
+        }
+    }
+    if (ranges.empty() || first < groups.size()) {
+        ranges.emplace_back(first, groups.size());
+    }
+    queryTimingsAdd(prediction_data->timings, prediction_data->query_index, kStageMedianSeqInfo, begin);
+
+    submitRanges(prediction_data, ranges, threadMedianSeqInfo);
+
+    return nullptr;
+}
+
+void* threadMedianSeqInfo(void* params) {
+
+    auto thread_data = (ThreadRangeData*) params;
+    auto prediction_data = thread_data->prediction_data;
+
+    uint64_t begin = timerNow();
+
+    for (uint32_t i = thread_data->begin; i < thread_data->end; ++i) {
+        calcMedianSeqInfoGroup(prediction_data->alignment_string, prediction_data->groups[i]);
+    }
+
+    queryTimingsAdd(prediction_data->timings, prediction_data->query_index, kStageMedianSeqInfo, begin);
+
+    delete thread_data;
+
+    if (--prediction_data->pending == 0) {
+        auto& medianSeqInfoForPos = prediction_data->store_writer != nullptr ?
+            prediction_data->store_median : prediction_data->medianSeqInfoForPos;
+        setMedianSeqInfo(prediction_data->groups, medianSeqInfoForPos);
+
+        for (auto& it: prediction_data->outputs) {
+            for (uint32_t pos = 0; pos < it.medianSeqInfoForPos.size(); ++pos) {
+                if (it.medianSeqInfoForPos[pos] == kMedianSeqInfoRequested) {
+                    it.medianSeqInfoForPos[pos] = medianSeqInfoForPos[pos];
+                }
+            }
+        }
+        outputPrediction(prediction_data);
+        finishPrediction(prediction_data);
+    }
+
     return nullptr;
 }
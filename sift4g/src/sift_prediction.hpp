@@ -11,11 +11,83 @@
 #include <stdint.h>
 #include <vector>
 #include <string>
+#include <functional>
+
+#include "msa.hpp"
+#include "sift_scores.hpp"
+#include "score_matrix.hpp"
+#include "query_schedule.hpp"
+#include "alignment_cache.hpp"
+#include "checkpoint.hpp"
 
 #include "swsharp/swsharp.h"
 
-void checkData(Chain** queries, int32_t& queries_length, const std::string& subst_path);
+/* parses the lines of a substitution file, returns false if a substitution does not match
+the query or no line is valid */
+bool parseSubstitutions(std::vector<Substitution>& dst, const std::vector<std::string>& lines,
+    Chain* query);
+
+/* invalid queries are removed, substitutions are parsed for each remaining query
+and left empty for queries without a substitution file */
+void checkData(Chain** queries, int32_t& queries_length, const std::string& subst_path,
+    std::vector<std::vector<Substitution>>& substitutions);
+
+/*!
+ * @brief Prediction of one query kept in memory instead of written to files,
+ * scores are the SIFT scores of all positions, prediction holds the contents of
+ * the .SIFTprediction file and total_seq the number of sequences it was based on;
+ * is_predicted is false for queries without selected alignments.
+ */
+class PredictionResult {
+public:
+    PredictionResult()
+            : is_predicted(false), scores(0), total_seq(0), prediction() {
+    }
+
+    bool is_predicted;
+    ScoreMatrix scores;
+    int32_t total_seq;
+    std::string prediction;
+};
+
+/*!
+ * @brief Selection and scoring parameters of one prediction run and where its
+ * outputs are written. If archive_path is not empty all files are stored in that
+ * archive instead of out_path, if store_path is not empty score matrices, median
+ * sequence info and sequence counts of all positions are stored in a score store
+ * (see score_store.hpp). If completed_path is not empty, completedLine() of each
+ * group is appended to it after all files of the group are written (see checkpoint.hpp).
+ * If results is set, predictions are stored in it (indexed by query) instead of
+ * written to out_path.
+ */
+class PredictionSettings {
+public:
+    float threshold;
+    int32_t sequence_identity;
+    std::string out_path;
+    std::string archive_path;
+    std::string store_path;
+    std::string completed_path;
+    std::vector<PredictionResult>* results = nullptr;
+};
+
+/* creates a setting for each combination of median thresholds and sequence identities,
+outputs of multiple settings are written to subdirectories threshold_<float>_seq_id_<int>
+of out_path, which are created */
+void createPredictionSettings(std::vector<PredictionSettings>& dst,
+    const std::vector<float>& median_thresholds, const std::vector<int32_t>& sequence_identities,
+    const std::string& out_path, bool archive, bool score_store);
 
-void siftPredictions(std::vector<std::vector<Chain*>>& alignment_strings,
-    Chain** queries, int32_t queries_length, const std::string& subst_path,
-    int32_t sequence_identity, const std::string& out_path);
+/* selects the alignments of each group of identical queries (see groupIdenticalQueries)
+once per median threshold and writes SIFT predictions (and selected alignments if
+sub_results is set) of each of its queries for each of the settings as soon as they are
+done, alignments and alignments_lengths are indexed by group and deleted after selection;
+settings with equal thresholds have to be adjacent; if cache is given, selected alignments
+of groups set in cached_groups are loaded from it and those of other groups are stored to it;
+groups whose cache entry can not be loaded anymore are passed to align_groups, which has
+to set their alignments and alignments_lengths, and are processed again */
+void siftPredictions(DbAlignment*** alignments, int32_t* alignments_lengths,
+    const std::vector<std::vector<uint32_t>>& query_groups, Chain** queries,
+    std::vector<std::vector<Substitution>>& substitutions, const std::vector<PredictionSettings>& settings,
+    bool sub_results, AlignmentCache* cache, const std::vector<bool>& cached_groups,
+    QueryTimings* timings, const std::function<void(const std::vector<uint32_t>&)>& align_groups);
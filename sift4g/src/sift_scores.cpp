@@ -7,14 +7,16 @@
  */
 
 #include <stdio.h>
+#include <ctype.h>
 #include <math.h>
 #include <cstring>
 #include <ostream>
 #include <iostream>
 #include <fstream>
-#include <regex>
+#include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <map>
 
 #include "utils.hpp"
 #include "constants.hpp"
@@ -23,135 +25,249 @@
 constexpr uint32_t kMaxSequences = 400;
 constexpr double TOLERANCE_PROB_THRESHOLD = 0.05;
 constexpr double ADEQUATE_SEQ_INFO =3.25;
+/* safety margin for lower bounds of SIFT scores compared against TOLERANCE_PROB_THRESHOLD */
+constexpr double kLazyScoreMargin = 1e-9;
 // init_frq_qij
 constexpr double LOCAL_QIJ_RTOT = 5.0;
 
-void scale_matrix_to_max_aa(std::vector<std::vector <double>>& matrix, std::vector<int>& max_aa_array) {
+constexpr int kDiriComponents = (int) (sizeof(diri_altot) / sizeof(diri_altot[0]));
+/* integer counts below this value are looked up in DiriTables */
+constexpr uint32_t kDiriTableCounts = 512;
+/* number of positions whose Dirichlet pseudocounts are computed together */
+constexpr uint32_t kDiriBatch = 16;
 
-    int query_length = matrix.size();
-    int aas = matrix[0].size();
+/*!
+ * @brief lgamma values needed by add_diric_values. Values which depend only on
+ * the Dirichlet mixture are computed once, values for integer counts (raw,
+ * unweighted counts) are tabulated and everything else is computed with
+ * lgamma directly. All values are identical to calling lgamma each time.
+ */
+class DiriTables {
+public:
+    DiriTables() :
+            lgamma_count_(kDiriTableCounts), lgamma_count_altot_(kDiriTableCounts * kDiriComponents),
+            lgamma_count_alpha_(kDiriTableCounts * kDiriComponents * 26) {
+
+        for (int j = 0; j < kDiriComponents; ++j) {
+            log_q[j] = log(diri_q[j]);
+            lgamma_altot[j] = lgamma(diri_altot[j]);
+            for (int aa_index = 0; aa_index < 26; ++aa_index) {
+                lgamma_alpha[j][aa_index] = lgamma(diri_alpha[j][aa_index]);
+            }
+        }
 
-    for (int pos = 0; pos < query_length; pos++) {
-        int max_aa = max_aa_array[pos];
-        double max_aa_score = matrix[pos][max_aa];
-        for (int aa_index = 0; aa_index < aas; aa_index++) {
-            matrix[pos][aa_index] = matrix[pos][aa_index] / max_aa_score;
+        for (uint32_t n = 0; n < kDiriTableCounts; ++n) {
+            double count = n;
+            lgamma_count_[n] = lgamma(count + 1.0);
+            for (int j = 0; j < kDiriComponents; ++j) {
+                lgamma_count_altot_[n * kDiriComponents + j] = lgamma(count + diri_altot[j]);
+                for (int aa_index = 0; aa_index < 26; ++aa_index) {
+                    lgamma_count_alpha_[(n * kDiriComponents + j) * 26 + aa_index] =
+                        lgamma(count + diri_alpha[j][aa_index]);
+                }
+            }
+        }
+    }
+
+    /* lgamma(count + 1.0) */
+    double lgammaCount(double count) const {
+        uint32_t n;
+        if (isTabulated(count, n)) {
+            return lgamma_count_[n];
+        }
+        return lgamma(count + 1.0);
+    }
+
+    /* lgamma(count + diri_altot[j]) */
+    double lgammaCountAltot(double count, int j) const {
+        uint32_t n;
+        if (isTabulated(count, n)) {
+            return lgamma_count_altot_[n * kDiriComponents + j];
+        }
+        return lgamma(count + diri_altot[j]);
+    }
+
+    /* lgamma(count + diri_alpha[j][aa_index]) */
+    double lgammaCountAlpha(double count, int j, int aa_index) const {
+        uint32_t n;
+        if (isTabulated(count, n)) {
+            return lgamma_count_alpha_[(n * kDiriComponents + j) * 26 + aa_index];
         }
+        return lgamma(count + diri_alpha[j][aa_index]);
     }
+
+    double log_q[kDiriComponents];
+    double lgamma_altot[kDiriComponents];
+    double lgamma_alpha[kDiriComponents][26];
+
+private:
+
+    static bool isTabulated(double count, uint32_t& n) {
+        if (count >= 0.0 && count < kDiriTableCounts) {
+            n = (uint32_t) count;
+            return n == count;
+        }
+        return false;
+    }
+
+    std::vector<double> lgamma_count_;
+    std::vector<double> lgamma_count_altot_;
+    std::vector<double> lgamma_count_alpha_;
+};
+
+static const DiriTables& diriTables() {
+    static DiriTables tables;
+    return tables;
 }
 
-void find_max_aa_in_matrix(std::vector<std::vector<double>>& matrix, std::vector<int>& max_aa_index) {
-    int query_length = matrix.size();
-    int aas = matrix[0].size();
+int find_max_aa(const double* matrix_pos) {
 
-    for (int pos = 0; pos < query_length; pos++) {
-        int max_aa = -1;
-        double max_count = -1.0;
-        for (int aa_index =0; aa_index < aas; aa_index++) {
-            if (matrix[pos][aa_index] > max_count) {
-                max_aa = aa_index;
-                max_count = matrix[pos][aa_index];
-            }
+    int max_aa = -1;
+    double max_count = -1.0;
+    for (int aa_index = 0; aa_index < 26; aa_index++) {
+        if (matrix_pos[aa_index] > max_count) {
+            max_aa = aa_index;
+            max_count = matrix_pos[aa_index];
         }
-        max_aa_index[pos] = max_aa;
     }
+    return max_aa;
 }
 
-void calcEpsilon(std::vector<std::vector<double>>& weighted_matrix, std::vector<int>& max_aa_array,
-    std::vector<double>& number_of_diff_aas, std::vector<double>& epsilon) {
+double calcEpsilon(const double* weighted_pos, int max_aa, double number_of_diff_aas) {
 
-    int query_length = weighted_matrix.size();
-    /*vector <int> max_aa_array (query_length);
-    find_max_aa_in_matrix (weighted_matrix, max_aa_array);*/
+    if (number_of_diff_aas == 1) {
+        return 0;
+    }
 
-    for (int pos =0; pos < query_length; pos++) {
-        if (number_of_diff_aas[pos] == 1) {
-            epsilon[pos] = 0;
-        } else {
-            int max_aa = max_aa_array[pos];
-            double sum = 0.0;
-            double pos_tot = 0.0;
-            for (char aa = 'A'; aa <= 'Z'; aa++) {
-                if (valid_amino_acid(aa)) {
-                    int aa_index = int(aa) - int('A');
-                    int rank = rank_matrix[max_aa][aa_index];
-                    sum += (double) rank * weighted_matrix[pos][aa_index];
-                    pos_tot +=  weighted_matrix[pos][aa_index];
-                }
-            }
-            sum = sum / pos_tot;
-            epsilon[pos] = exp((double) sum);
-        }
+    const int* rank = rank_matrix[max_aa];
+    double sum = 0.0;
+    double pos_tot = 0.0;
+    /* invalid amino acids are masked out */
+    for (int aa_index = 0; aa_index < 26; aa_index++) {
+        double weight = weighted_pos[aa_index] * valid_aa_mask[aa_index];
+        sum += (double) rank[aa_index] * weight;
+        pos_tot += weight;
     }
+    sum = sum / pos_tot;
+    return exp((double) sum);
 }
 
-void readSubstFile(char* substFilename, std::list<std::string>& substList) {
+bool parseSubstitution(const std::string& line, Substitution& dst) {
 
-    std::ifstream infile(substFilename);
-    std::string line;
+    // equivalent to matching ^([A-Z])([0-9]+)([A-Z])
+    uint32_t i = 0;
+    if (line.size() < 3 || line[i] < 'A' || line[i] > 'Z') {
+        return false;
+    }
+    dst.ref_aa = line[i++];
+
+    int64_t pos = 0;
+    uint32_t digits_begin = i;
+    for (; i < line.size() && line[i] >= '0' && line[i] <= '9'; ++i) {
+        pos = std::min<int64_t>(pos * 10 + (line[i] - '0'), INT32_MAX);
+    }
+    if (i == digits_begin || i == line.size() || line[i] < 'A' || line[i] > 'Z') {
+        return false;
+    }
+    dst.pos = (int32_t) pos - 1;
+    dst.alt_aa = line[i];
 
-    if (infile.good()) {
-        while (std::getline(infile, line)) {
-            substList.push_back(line);
+    // first whitespace separated word of the line
+    uint32_t token_end = i;
+    while (token_end < line.size() && !isspace((unsigned char) line[token_end])) {
+        ++token_end;
+    }
+    dst.token = line.substr(0, token_end);
+
+    return true;
+}
+
+void createMedianSeqInfoGroups(const Msa& alignment_string,
+    const std::vector<double>& medianSeqInfoForPos, std::vector<MedianSeqInfoGroup>& groups) {
+
+    uint32_t words = (alignment_string.size() + 63) / 64;
+    std::map<std::vector<uint64_t>, uint32_t> group_ids;
+    std::vector<uint64_t> valid_rows(words);
+
+    for (uint32_t pos = 0; pos < medianSeqInfoForPos.size(); ++pos) {
+        if (medianSeqInfoForPos[pos] != kMedianSeqInfoRequested) {
+            continue;
         }
+
+        /* get sequences that don't have X or invalid aa */
+        std::vector<uint32_t> rows_with_noX_at_pos;
+        seqs_without_X(alignment_string, pos, rows_with_noX_at_pos);
+
+        std::fill(valid_rows.begin(), valid_rows.end(), 0);
+        for (const auto& row: rows_with_noX_at_pos) {
+            valid_rows[row / 64] |= (uint64_t) 1 << (row % 64);
+        }
+
+        auto group = group_ids.find(valid_rows);
+        if (group == group_ids.end()) {
+            group = group_ids.emplace(valid_rows, groups.size()).first;
+            groups.emplace_back();
+            groups.back().rows.swap(rows_with_noX_at_pos);
+        }
+        groups[group->second].positions.emplace_back(pos);
     }
-    infile.close();
 }
 
-void addMedianSeqInfo(std::vector<Chain*>& alignment_string, Chain* query, std::vector<std::vector<double>>& matrix,
-    std::unordered_map<std::string,double>& medianSeqInfoForPos) {
+void calcMedianSeqInfoGroup(const Msa& alignment_string, MedianSeqInfoGroup& group) {
+
+    int num_seqs_in_alignment = group.rows.size();
+    if (num_seqs_in_alignment == 0) {
+        group.median = 0.0;
+        return;
+    }
 
-    int query_length = matrix.size();
+    int query_length = alignment_string.length();
     std::vector<double> number_of_diff_aas(query_length);
 
-    for (auto it = medianSeqInfoForPos.begin(); it != medianSeqInfoForPos.end(); ++it) {
-        int pos = stoi(it->first); // position in protein, start count at 1
-        pos = pos -1;  // position in array
-        if (it->second == -1) {
-            /* get sequences that don't have X or invalid aa */
-            std::unordered_map <int, int> invalidSeq;
-            for (int i = 0; i < (int) alignment_string.size(); i++) {
-                char c = chainGetChar(alignment_string[i], pos);
-                if (!valid_amino_acid(c)) {
-                    invalidSeq.insert({i,1}); //invalidSeq[i] = 1;
-                }
-            }
-            std::vector<Chain*> alignment_with_noX_at_pos;
-            seqs_without_X(alignment_string, pos, alignment_with_noX_at_pos );
+    auto alignment_with_noX_at_pos = alignment_string.subset(group.rows);
 
-            int num_seqs_in_alignment = alignment_with_noX_at_pos.size();
-            if (num_seqs_in_alignment == 0) {
-                medianSeqInfoForPos[it->first] = 0.0;
-                continue;
-            }
+    /* raw counts of valid amino acids */
+    std::vector<double> aas_stored_at_each_pos (query_length);
+    ScoreMatrix matrix_noX_raw(query_length);
+
+    /* have to recalculate sequence weights,
+    calcSeqWeights is the only function where all sequences
+    and all positions have to be looked at at the same time.
+    all other routines treat each position independently */
+    calcSeqWeights(*alignment_with_noX_at_pos, matrix_noX_raw, aas_stored_at_each_pos,
+        number_of_diff_aas);
+    ScoreMatrix matrix_noX(query_length);
 
-            /* have to recalculate sequence weights */
-            std::vector<double> weights_1 (num_seqs_in_alignment, 1.0);
-            /* raw counts of valid amino acids */
-            std::vector<double> aas_stored_at_each_pos (query_length);
-            std::vector<std::vector<double>> matrix_noX_raw(query_length, std::vector<double>(26, 0.0));
+    basic_matrix_construction(*alignment_with_noX_at_pos, matrix_noX);
+    // printMatrix (matrix, "tmp_basicmatrix.txt");
+    group.median = calculateMedianSeqInfo(matrix_noX);
+}
 
-            createMatrix(alignment_with_noX_at_pos, query, weights_1, matrix_noX_raw, aas_stored_at_each_pos);
-                std::vector <double> seq_weights (num_seqs_in_alignment);
-            /* calcSeqWeights is the only function where all sequences
-            and all positions have to be looked at at the same time.
-            all other routines treat each position independently */
-            calcSeqWeights (alignment_with_noX_at_pos,matrix_noX_raw, aas_stored_at_each_pos, seq_weights,
-                number_of_diff_aas);
-            std::vector<std::vector<double>> matrix_noX (query_length, std::vector<double>(26, 0.0));
+void setMedianSeqInfo(const std::vector<MedianSeqInfoGroup>& groups,
+    std::vector<double>& medianSeqInfoForPos) {
 
-            basic_matrix_construction(alignment_with_noX_at_pos, seq_weights, matrix_noX);
-            // printMatrix (matrix, "tmp_basicmatrix.txt");
-            double medianSeqInfo = calculateMedianSeqInfo(alignment_with_noX_at_pos, invalidSeq, seq_weights, matrix_noX);
-            medianSeqInfoForPos[it->first] = medianSeqInfo;
+    for (const auto& group: groups) {
+        for (const auto& pos: group.positions) {
+            medianSeqInfoForPos[pos] = group.median;
         }
     }
 }
 
-double calculateMedianSeqInfo(std::vector<Chain*>& alignment_strings, std::unordered_map<int, int>& invalidSeq,
-    std::vector<double>& seq_weights, std::vector<std::vector<double>>& matrix) {
+void addMedianSeqInfo(const Msa& alignment_string, std::vector<double>& medianSeqInfoForPos) {
+
+    std::vector<MedianSeqInfoGroup> groups;
+    createMedianSeqInfoGroups(alignment_string, medianSeqInfoForPos, groups);
+
+    for (auto& group: groups) {
+        calcMedianSeqInfoGroup(alignment_string, group);
+    }
+
+    setMedianSeqInfo(groups, medianSeqInfoForPos);
+}
+
+double calculateMedianSeqInfo(ScoreMatrix& matrix) {
 
-    int query_len = chainGetLength(alignment_strings[0]);
+    int query_len = matrix.length();
     int amino_acid_num = 26;
     float median = kLog_2_20;
     double tmp = 0.0;
@@ -199,38 +315,31 @@ double calculateMedianSeqInfo(std::vector<Chain*>& alignment_strings, std::unord
     return median;
 }
 
-void hashPredictedPos(std::list<std::string>& substList, std::unordered_map<std::string, double>& medianSeqInfoForPos) {
+void hashPredictedPos(const std::vector<Substitution>& substitutions, std::vector<double>& medianSeqInfoForPos) {
 
-    std::list<std::string>::const_iterator iterator;
-
-    std::regex regexSubst ("^[A-Z]([0-9]+)[A-Z]");  /*, std::regex_constants::basic); */
-    std::smatch m;
-
-    for (iterator = substList.begin(); iterator != substList.end(); ++iterator)     {
-        std::string substLine = *iterator;
-        if (regex_search(substLine, m, regexSubst)) {
-            std::string string_pos = m[1];
-            medianSeqInfoForPos[string_pos] = -1;
+    for (const auto& it: substitutions) {
+        if (it.pos >= 0 && it.pos < (int32_t) medianSeqInfoForPos.size()) {
+            medianSeqInfoForPos[it.pos] = kMedianSeqInfoRequested;
         }
     }
 }
 
-void addPosWithDelRef(Chain* query, std::vector<std::vector<double>>& SIFTscores,
-    std::unordered_map<std::string, double>& medianSeqInfoForPos) {
+void addPosWithDelRef(Chain* query, ScoreMatrix& SIFTscores,
+    std::vector<double>& medianSeqInfoForPos) {
 
-    int query_length = SIFTscores.size();
+    int query_length = SIFTscores.length();
 
     for (int pos = 0; pos < query_length; pos++) {
         char ref_aa = chainGetChar(query, pos);
         int ref_aa_index = (int) ref_aa - (int) 'A';
 
         if (SIFTscores[pos][ref_aa_index] < TOLERANCE_PROB_THRESHOLD) {
-            medianSeqInfoForPos[std::to_string(pos + 1)] = -1; // pos + 1 because the substitution files are 1-based
+            medianSeqInfoForPos[pos] = kMedianSeqInfoRequested;
         }
     }
 }
 
-void check_refaa_against_query(char ref_aa, int aa_pos, Chain* query, std::ofstream& outfp) {
+void check_refaa_against_query(char ref_aa, int aa_pos, Chain* query, std::ostream& outfp) {
     char aa = chainGetChar(query, aa_pos);
     if (aa != ref_aa) {
         outfp << "WARNING! Amino acid " << aa << " is at position " <<
@@ -244,73 +353,51 @@ std::string print_double(double num, int precision) {
     return stream.str();
 }
 
-void printSubstFile(const std::list<std::string>& substList, std::unordered_map<std::string, double>& medianSeqInfoForPos,
-    const std::vector<std::vector<double>>& SIFTscores, const std::vector<double>& aas_stored,
-    const int total_seq, Chain* query, const std::string outfile) {
+void printSubstFile(const std::vector<Substitution>& substitutions, const std::vector<double>& medianSeqInfoForPos,
+    const ScoreMatrix& SIFTscores, const std::vector<double>& aas_stored,
+    const int total_seq, Chain* query, std::string& dst) {
 
-    std::list<std::string>::const_iterator iterator;
-    std::regex regexSubst ("^([A-Z])([0-9]+)([A-Z])");  /*, std::regex_constants::basic); */
-    std::smatch m;
-    std::ofstream outfp;
-    outfp.open(outfile, std::ios::out);
-    int query_length = SIFTscores.size();
+    std::ostringstream outfp;
+    int query_length = SIFTscores.length();
 
     for (int pos = 0; pos < query_length; pos++) {
         char ref_aa = chainGetChar(query, pos);
         int ref_aa_index = (int) ref_aa - (int) 'A';
 
         if (SIFTscores[pos][ref_aa_index] < TOLERANCE_PROB_THRESHOLD) {
-            auto search = medianSeqInfoForPos.find(std::to_string(pos + 1));
-            if (search == medianSeqInfoForPos.end()) {
+            if (medianSeqInfoForPos[pos] == kMedianSeqInfoAbsent) {
                 // missing position
                 continue;
             }
-            double median = search->second;
+            double median = medianSeqInfoForPos[pos];
             if (median < ADEQUATE_SEQ_INFO) {
+                // reports the median of the preceding position, 0 if it was not calculated
+                double reported_median = (pos > 0 && medianSeqInfoForPos[pos - 1] != kMedianSeqInfoAbsent) ?
+                    medianSeqInfoForPos[pos - 1] : 0.0;
                 outfp << "WARNING! " << ref_aa << std::to_string(pos+1) << " not allowed! score: " <<
                     print_double( SIFTscores[pos][ref_aa_index],2) << " median: " <<
-                    print_double(medianSeqInfoForPos[std::to_string(pos)],2) << " # of sequence: " <<
+                    print_double(reported_median,2) << " # of sequence: " <<
                     std::to_string((int) aas_stored[pos]) << std::endl;
             }
         } /* end if less than TOLERANCE_PROB_THRESHOLD */
     }
 
-    for (iterator = substList.begin(); iterator != substList.end(); ++iterator) 	{
-        std::string substLine = *iterator;
-        std::stringstream ss(std::stringstream::in | std::stringstream::out);
-        ss << substLine;
-        std::string cleanSubst;
-        ss >> cleanSubst;
-
-        if (regex_search(substLine, m, regexSubst)) {
-            char tmp[10];
-            std::string tmp_string = m[1];
-            std::strncpy(tmp, tmp_string.c_str(), tmp_string.size()+1);
-            char ref_aa = tmp[0]; //.c_str()[0];
-            std::string aa_pos_string = m[2];
-            int aa_pos = stoi ( aa_pos_string); //.c_str());
-            aa_pos = aa_pos -1; // position in array
-            tmp_string = m[3];
-            std::strncpy(tmp, tmp_string.c_str(), tmp_string.size()+1);
-            char new_aa = tmp[0]; //.c_str()[0];
-
-            int new_aa_index = (int) new_aa - (int) 'A';
-            double score = SIFTscores[aa_pos][new_aa_index];
-
-            check_refaa_against_query(ref_aa, aa_pos, query, outfp);
-            outfp << cleanSubst << "\t";
-            if (score >= TOLERANCE_PROB_THRESHOLD) {
-                outfp << "TOLERATED\t" << print_double(score,2);
-            } else {
-                outfp << "DELETERIOUS\t" << print_double(score,2);
-            }
-            auto search = medianSeqInfoForPos.find(aa_pos_string);
-            outfp << "\t" << print_double(search->second,2) << "\t" <<
-                std::to_string((int) aas_stored[aa_pos]) << "\t" << std::to_string(total_seq) << std::endl;
+    for (const auto& it: substitutions) {
+        int new_aa_index = (int) it.alt_aa - (int) 'A';
+        double score = SIFTscores[it.pos][new_aa_index];
+
+        check_refaa_against_query(it.ref_aa, it.pos, query, outfp);
+        outfp << it.token << "\t";
+        if (score >= TOLERANCE_PROB_THRESHOLD) {
+            outfp << "TOLERATED\t" << print_double(score,2);
+        } else {
+            outfp << "DELETERIOUS\t" << print_double(score,2);
         }
+        outfp << "\t" << print_double(medianSeqInfoForPos[it.pos],2) << "\t" <<
+            std::to_string((int) aas_stored[it.pos]) << "\t" << std::to_string(total_seq) << std::endl;
     }
 
-    outfp.close();
+    dst += outfp.str();
 }
 
 bool valid_amino_acid(char aa) {
@@ -321,67 +408,87 @@ bool valid_amino_acid(char aa) {
     }
 }
 
-void calcSIFTScores(std::vector<Chain*>& alignment_string, Chain* query, std::vector<std::vector<double>>& matrix,
-    std::vector<std::vector<double>>& SIFTscores) {
-
-    int query_length = matrix.size();
-
-    std::vector<int> max_aa_array(query_length);
-    std::vector<double> number_of_diff_aas(query_length);
-    std::vector<double> epsilon(query_length);
-
-    int num_seqs_in_alignment = alignment_string.size();
-    std::vector<std::vector<double>> raw_count_matrix(query_length, std::vector<double>(26, 0.0));
-
-    /* initialize an array with weight 1 */
-    std::vector<double> weights_1(num_seqs_in_alignment, 1.0);
-
-    /* raw counts of valid amino acids */
-    std::vector<double> aas_stored_at_each_pos(query_length);
-    createMatrix(alignment_string, query, weights_1, raw_count_matrix, aas_stored_at_each_pos);
-
-    std::vector <double> seq_weights (num_seqs_in_alignment);
-
-    /* calcSeqWeights is the only function where all sequences
-    and all positions have to be looked at at the same time.
-    all other routines treat each position independently */
-    calcSeqWeights (alignment_string, matrix, aas_stored_at_each_pos, seq_weights,
-        number_of_diff_aas);
+/* scores positions whose Dirichlet pseudocounts are computed in one batch */
+static void scoreDiriBatch(const ScoreMatrix& seq_weighted_matrix, const std::vector<double>& tot_weights_each_pos,
+    ScoreMatrix& SIFTscores, const uint32_t* batch_pos, const double* batch_epsilon, uint32_t batch_length) {
 
-    /* now construct matrix with weighted sequence values */
-    std::vector<std::vector<double>> seq_weighted_matrix(query_length, std::vector<double>(26,0.0));
-    std::vector<double> tot_weights_each_pos(query_length);
+    if (batch_length == 0) {
+        return;
+    }
 
-    createMatrix(alignment_string, query, seq_weights, seq_weighted_matrix, tot_weights_each_pos);
+    const double* batch_counts[kDiriBatch] = {nullptr};
+    double batch_diric[kDiriBatch][kMatrixWidth] = {{0}};
+    double* batch_diric_cols[kDiriBatch] = {nullptr};
+    for (uint32_t i = 0; i < batch_length; i++) {
+        batch_counts[i] = seq_weighted_matrix[batch_pos[i]];
+        batch_diric_cols[i] = batch_diric[i];
+    }
 
-    find_max_aa_in_matrix(seq_weighted_matrix, max_aa_array);
+    /* pseudo_diri */
+    add_diric_values(batch_counts, batch_diric_cols, batch_length);
 
-    calcEpsilon(seq_weighted_matrix, max_aa_array, number_of_diff_aas, epsilon );
+    for (uint32_t i = 0; i < batch_length; i++) {
+        const double* weighted_pos = batch_counts[i];
+        double* scores_pos = SIFTscores[batch_pos[i]];
 
-    /* pseudo_diri */
-    std::vector<std::vector<double>> diric_matrix(query_length, std::vector<double>(26, 0.0));
-    calcDiri(seq_weighted_matrix, diric_matrix);
-    //printMatrix (diric_matrix, "diri_matrix.txt");
+        double tot_weight_pos = tot_weights_each_pos[batch_pos[i]] + batch_epsilon[i];
+        for (uint32_t aa_index = 0; aa_index < kMatrixWidth; aa_index++) {
+            scores_pos[aa_index] = weighted_pos[aa_index] + batch_epsilon[i] * batch_diric[i][aa_index];
+            scores_pos[aa_index] /= tot_weight_pos;
+        }
 
-    for (int pos= 0; pos < query_length; pos++) {
-        for (char aa = 'A'; aa <= 'Z'; aa++) {
-            int aa_index = (int) aa - (int) 'A';
-            SIFTscores[pos][aa_index] = seq_weighted_matrix[pos][aa_index] + epsilon[pos] * diric_matrix[pos][aa_index];
-            SIFTscores[pos][aa_index] /= (tot_weights_each_pos[pos] + epsilon[pos]);
+        /* have to find max aa again because it'schanged with newly added weights */
+        double max_aa_score = scores_pos[find_max_aa(scores_pos)];
+        for (uint32_t aa_index = 0; aa_index < kMatrixWidth; aa_index++) {
+            scores_pos[aa_index] = scores_pos[aa_index] / max_aa_score;
         }
     }
-    /* have to find max aa again because it'schanged with newly added weights */
-    find_max_aa_in_matrix(SIFTscores, max_aa_array);
-    scale_matrix_to_max_aa(SIFTscores, max_aa_array);
-    // printMatrix(SIFTscores, "siftscores_matrix.txt");
 }
 
-void calcDiri(std::vector<std::vector<double>>& count_matrix, std::vector<std::vector<double>>& diric_matrix) {
+void calcSIFTScores(const Msa& alignment_string, const ScoreMatrix& seq_weighted_matrix,
+    const std::vector<double>& tot_weights_each_pos, const std::vector<double>& number_of_diff_aas,
+    ScoreMatrix& SIFTscores, const std::vector<bool>* scored_positions, uint32_t begin, uint32_t end) {
+
+    /* positions which need Dirichlet pseudocounts are collected and computed in batches */
+    uint32_t batch_pos[kDiriBatch];
+    double batch_epsilon[kDiriBatch];
+    uint32_t batch_length = 0;
+
+    for (uint32_t pos = begin; pos < end; pos++) {
+        const double* weighted_pos = seq_weighted_matrix[pos];
+        double* scores_pos = SIFTscores[pos];
+
+        int max_aa = find_max_aa(weighted_pos);
+        double epsilon_pos = calcEpsilon(weighted_pos, max_aa, number_of_diff_aas[pos]);
+
+        /* Dirichlet values are at most 1, so the score of the query amino acid is at least
+        weighted[query_aa] / (weighted[max_aa] + epsilon); positions which are not requested and
+        whose query amino acid is tolerated by this bound are not scored, their rows hold the
+        lower bounds of their scores */
+        if (scored_positions != nullptr && !(*scored_positions)[pos]) {
+            int query_aa = alignment_string.column(pos)[0];
+            double max_weight_pos = weighted_pos[max_aa] + epsilon_pos;
+            if (weighted_pos[query_aa] / max_weight_pos >= TOLERANCE_PROB_THRESHOLD + kLazyScoreMargin) {
+                for (uint32_t aa_index = 0; aa_index < kMatrixWidth; aa_index++) {
+                    scores_pos[aa_index] = weighted_pos[aa_index] / max_weight_pos;
+                }
+                continue;
+            }
+        }
 
-    int query_length = count_matrix.size();
-    for (int pos = 0; pos < query_length; pos++) {
-        add_diric_values(count_matrix[pos], diric_matrix[pos]);
+        batch_pos[batch_length] = pos;
+        batch_epsilon[batch_length] = epsilon_pos;
+        ++batch_length;
+
+        if (batch_length == kDiriBatch) {
+            scoreDiriBatch(seq_weighted_matrix, tot_weights_each_pos, SIFTscores, batch_pos,
+                batch_epsilon, batch_length);
+            batch_length = 0;
+        }
     }
+
+    scoreDiriBatch(seq_weighted_matrix, tot_weights_each_pos, SIFTscores, batch_pos,
+        batch_epsilon, batch_length);
 }
 
 double add_logs (double logx, double logy) {
@@ -392,187 +499,251 @@ double add_logs (double logx, double logy) {
     }
 }
 
-void add_diric_values(std::vector<double>& count_col, std::vector<double>& diric_col) {
+void add_diric_values(const double* count_col, double* diric_col) {
+    add_diric_values(&count_col, &diric_col, 1);
+}
+
+void add_diric_values(const double* const* count_cols, double* const* diric_cols, uint32_t cols_length) {
+
+    const DiriTables& tables = diriTables();
+
+    const int diri_comp_num = kDiriComponents;
+
+    struct Column {
+        double pos_count_tot;
+        double lgamma_pos_count_tot;
+        int present_num;
+        int present_aa[26];
+        double present_count[26];
+        double present_lgamma_count[26];
+        double probn[kDiriComponents];
+    };
+    Column columns[kDiriBatch];
+
+    ASSERT(cols_length <= kDiriBatch, "too many Dirichlet columns");
 
-    double tmp;
-    int diri_comp_num = (int) (sizeof (diri_altot)/sizeof (diri_altot[0]));
-    std::vector<double> probn(diri_comp_num, 0.0);
-    std::vector<double> probj(diri_comp_num,0.0);
+    for (uint32_t c = 0; c < cols_length; c++) {
+        const double* count_col = count_cols[c];
+        Column& column = columns[c];
 
-    double pos_count_tot = 0.0;
-    for (int j=0; j < (int) count_col.size(); j++) {
-        pos_count_tot += count_col[j];
+        column.pos_count_tot = 0.0;
+        for (int j=0; j < 26; j++) {
+            column.pos_count_tot += count_col[j];
+        }
+
+        /* amino acids with zero counts add lgamma(alpha) - lgamma(1) - lgamma(alpha) = 0
+        to Prob(n|j) and are skipped */
+        column.present_num = 0;
+        for (int aa_index = 0; aa_index < 26; aa_index++) {
+            if (valid_aa[aa_index] && count_col[aa_index] != 0.0) {
+                column.present_aa[column.present_num] = aa_index;
+                column.present_count[column.present_num] = count_col[aa_index];
+                column.present_lgamma_count[column.present_num] = tables.lgammaCount(count_col[aa_index]);
+                ++column.present_num;
+            }
+        }
+
+        column.lgamma_pos_count_tot = tables.lgammaCount(column.pos_count_tot);
     }
 
     /*-----------   compute equation (3), Prob(n|j) ------------  */
+    /* components are the outer loop so that the mixture values of a component
+    are shared by all columns of the batch, the terms of each column are summed
+    in the same order as for a single column */
     for (int j = 0; j < diri_comp_num; j++) {
-        probn[j] = lgamma(pos_count_tot+1.0) + lgamma(diri_altot[j]);
-        probn[j] -= lgamma(pos_count_tot + diri_altot[j]);
+        const double lgamma_altot = tables.lgamma_altot[j];
+        const double* lgamma_alpha = tables.lgamma_alpha[j];
 
-        for (char aa = 'A'; aa <= 'Z'; aa++) {
-            int aa_index = (int) aa - (int) 'A';
-            if (valid_amino_acid(aa)) {
-                tmp = lgamma(count_col[aa_index] + diri_alpha[j][aa_index]);
-                tmp -= lgamma(count_col[aa_index] + 1.0);
-                tmp -= lgamma(diri_alpha[j][aa_index]);
-                probn[j] += tmp;
-            } /* end if greater than 0 */
-        } /* end all amino acids */
+        for (uint32_t c = 0; c < cols_length; c++) {
+            Column& column = columns[c];
+
+            double probn = column.lgamma_pos_count_tot + lgamma_altot;
+            probn -= tables.lgammaCountAltot(column.pos_count_tot, j);
+
+            for (int i = 0; i < column.present_num; i++) {
+                int aa_index = column.present_aa[i];
+                double tmp = tables.lgammaCountAlpha(column.present_count[i], j, aa_index);
+                tmp -= column.present_lgamma_count[i];
+                tmp -= lgamma_alpha[aa_index];
+                probn += tmp;
+            } /* end all amino acids */
+
+            column.probn[j] = probn;
+        } /* end all columns */
     } /* end for all Diri components */
 
-    /*------ compute sum qk * p(n|k) using logs & exponents ----------*/
-    double denom = log(diri_q[0]) + probn[0];
+    for (uint32_t c = 0; c < cols_length; c++) {
+        const double* probn = columns[c].probn;
+        double* diric_col = diric_cols[c];
 
-    for (int j =1; j < diri_comp_num; j++) {
-        double tmp = log(diri_q[j]) + probn[j];
-        denom = add_logs(denom, tmp);
-    }
+        /*------ compute sum qk * p(n|k) using logs & exponents ----------*/
+        double denom = tables.log_q[0] + probn[0];
 
-    /*   compute equation (3), Prob(j|n)  */
-    for (int j = 0; j < diri_comp_num; j++) {
-        probj[j] = log(diri_q[j]) + probn[j] - denom;
-    }
+        for (int j =1; j < diri_comp_num; j++) {
+            double tmp = tables.log_q[j] + probn[j];
+            denom = add_logs(denom, tmp);
+        }
 
-    double totreg = 0.0;
-    for (char aa = 'A'; aa <= 'Z'; aa++) {
-        if (valid_amino_acid(aa)) {
-            int aa_index = (int) aa - (int) 'A';
-            for (int j =0; j < (int) probj.size(); j++) {
-                diric_col[aa_index] += exp (probj[j]) * diri_alpha[j][aa_index];
-            } /* gone through all components */
-            totreg += diric_col[aa_index];
-        } /* end valid amino acid */
-    }
-    /* now normalize */
-    for (char aa= 'A'; aa <= 'Z'; aa++) {
-        int aa_index = (int) aa - (int) 'A';
-        diric_col[aa_index] /= totreg;
+        /* components are added in the same order for each amino acid as before,
+        alpha of invalid amino acids is masked out; Prob(j|n) is equation (3) */
+        for (int j = 0; j < diri_comp_num; j++) {
+            double prob = exp(tables.log_q[j] + probn[j] - denom);
+            for (int aa_index = 0; aa_index < 26; aa_index++) {
+                diric_col[aa_index] += prob * diri_alpha[j][aa_index] * valid_aa_mask[aa_index];
+            } /* gone through all amino acids */
+        }
+
+        double totreg = 0.0;
+        for (int aa_index = 0; aa_index < 26; aa_index++) {
+            totreg += diric_col[aa_index] * valid_aa_mask[aa_index];
+        }
+        /* now normalize */
+        for (uint32_t aa_index = 0; aa_index < kMatrixWidth; aa_index++) {
+            diric_col[aa_index] /= totreg;
+        }
     }
 }
 
-void calcSeqWeights(const std::vector<Chain*>& alignment_string, std::vector<std::vector<double>>& matrix,
-    std::vector<double>& amino_acids_present, std::vector<double>& seq_weights, std::vector<double>& number_of_diff_aas) {
+void calcSeqWeights(Msa& alignment_string, ScoreMatrix& matrix,
+    std::vector<double>& amino_acids_present, std::vector<double>& number_of_diff_aas) {
 
-    int query_length = matrix.size();
-    /* first calculate number of different aas at each position */
-    /* std::vector <int> number_of_diff_aas (query_length); */
+    int query_length = alignment_string.length();
+    int num_seqs_in_alignment = alignment_string.size();
+    std::vector<double>& seq_weights = alignment_string.weights();
 
-    /* initialize */
-    for (int pos = 0; pos < query_length; pos++) {
-        number_of_diff_aas[pos] = 0;
-    }
-    for (uint32_t seq_index = 0; seq_index < alignment_string.size(); seq_index++) {
+    for (int seq_index = 0; seq_index < num_seqs_in_alignment; seq_index++) {
         seq_weights[seq_index] = 0.0;
     }
 
-    /* now tabulate # of unique amino acids at each position */
+    /* raw counts, # of unique amino acids and position-based weights are
+    computed column by column, weights of each sequence are still summed
+    up in the order of positions */
     for (int pos = 0; pos < query_length; pos++) {
-        for (char aa = 'A'; aa <= 'Z'; aa++) {
-            int aa_index = int (aa) - int ('A');
-            if (valid_amino_acid(aa) &&  matrix[pos][aa_index] > 0.0) {
-                number_of_diff_aas[pos] += 1.0f;
+        const uint8_t* column = alignment_string.column(pos);
+        double* matrix_pos = matrix[pos];
+        for (int seq_index = 0; seq_index < num_seqs_in_alignment; seq_index++) {
+            int aa_index = column[seq_index];
+            if (valid_aa[aa_index]) {
+                matrix_pos[aa_index] += 1.0;
+                amino_acids_present[pos] += 1.0;
             }
         }
-    }
 
-    double tot = 0.0;
-    /* now calculate position-based weights */
-    for (uint32_t seq_index = 0; seq_index < alignment_string.size(); seq_index++) {
-        for (int pos = 0; pos < query_length; pos++) {
-            char aa = chainGetChar(alignment_string[seq_index], pos);
-            int aa_index = (int) aa - (int) 'A';
-            if (valid_amino_acid(aa) &&  matrix[pos][aa_index] > 0.0) {
-                double tmp = number_of_diff_aas[pos] * matrix[pos][aa_index];
-                seq_weights[seq_index] += 1.0/tmp;
+        double diff_aas = 0;
+        for (int aa_index = 0; aa_index < 26; aa_index++) {
+            diff_aas += (matrix_pos[aa_index] > 0.0) * valid_aa_mask[aa_index];
+        }
+        number_of_diff_aas[pos] = diff_aas;
+
+        double pos_weights[kMatrixWidth] = {0};
+        for (int aa_index = 0; aa_index < 26; aa_index++) {
+            if (valid_aa[aa_index] && matrix_pos[aa_index] > 0.0) {
+                double tmp = diff_aas * matrix_pos[aa_index];
+                pos_weights[aa_index] = 1.0/tmp;
+            }
+        }
+        for (int seq_index = 0; seq_index < num_seqs_in_alignment; seq_index++) {
+            int aa_index = column[seq_index];
+            if (valid_aa[aa_index]) {
+                seq_weights[seq_index] += pos_weights[aa_index];
             }
         }
+    }
+
+    double tot = 0.0;
+    for (int seq_index = 0; seq_index < num_seqs_in_alignment; seq_index++) {
         tot += seq_weights[seq_index];
     }
 
     /* normalize so weights sum up to the number of sequences */
-    double new_tot_weight = 0.0;
-    for (uint32_t seq_index = 0; seq_index<alignment_string.size(); seq_index++) {
-        seq_weights[seq_index] = seq_weights[seq_index] / tot * alignment_string.size()  ;
-        new_tot_weight += seq_weights[seq_index];
+    for (int seq_index = 0; seq_index < num_seqs_in_alignment; seq_index++) {
+        seq_weights[seq_index] = seq_weights[seq_index] / tot * num_seqs_in_alignment;
     }
 }
 
-void remove_seqs_percent_identical_to_query(Chain* queries, std::vector<Chain*>& alignment_string, double seq_identity) {
+void remove_seqs_percent_identical_to_query(Chain* queries, Msa& alignment_string, double seq_identity) {
 
     double identity;
     double seqTotal;
     int lenOfQuery = chainGetLength(queries);
-    int currPos = 0;
 
-    /*iterate through elements in vector of chains*/
-    while (currPos < int(alignment_string.size())){
+    /*see if alignment_string is indeed made to match query seq length*/
+    if (lenOfQuery != (int) alignment_string.length()) {
+        std::cout << "Length does not match!" << std::endl;
+        exit(1);
+    }
+
+    std::vector<uint8_t> query_codes(lenOfQuery);
+    for (int m = 0; m < lenOfQuery; m++) {
+        query_codes[m] = msaEncode(chainGetChar(queries, m));
+    }
+
+    std::vector<bool> remove(alignment_string.size(), false);
+
+    /*iterate through rows of the alignment*/
+    for (uint32_t currPos = 0; currPos < alignment_string.size(); currPos++) {
 
         identity = 0;
         seqTotal = 0;
-        int lenOfAlign = chainGetLength(alignment_string[currPos]);
-
-        /*see if alignment_string is indeed made to match query seq length*/
-        if (lenOfQuery == lenOfAlign){
-            for (int m = 0; m < lenOfAlign; m++){
-                /*compare each char of query to alignment_string char at same position in chain*/
-                char qChar = chainGetChar(queries, m);
-                char aChar = chainGetChar(alignment_string[currPos], m);
-
-                if (aChar != 'X'){
-                    if (valid_amino_acid(aChar) && valid_amino_acid(qChar)){
-                        seqTotal++;
-                        if (qChar == aChar){
-                            identity++;
-                        }
-                    }
+        const uint8_t* row = alignment_string.row(currPos);
+
+        for (int m = 0; m < lenOfQuery; m++) {
+            /*compare each char of query to alignment_string char at same position in row*/
+            uint8_t qChar = query_codes[m];
+            uint8_t aChar = row[m];
+
+            if (valid_aa[aChar] && valid_aa[qChar]) {
+                seqTotal++;
+                if (qChar == aChar) {
+                    identity++;
                 }
             }
-        } else {
-            std::cout << "Length does not match!" << std::endl;
-            exit(1);
         }
 
         double perc_similar = (identity / seqTotal) * 100;
-        /*Read curr element, delete if beyond threshold, else move to next pos*/
+        /*mark rows beyond threshold for deletion*/
         if (perc_similar >= seq_identity) {
-            chainDelete(alignment_string[currPos]);
-            alignment_string.erase(alignment_string.begin() + currPos);
-        } else {
-            currPos++;
+            remove[currPos] = true;
         }
     }
+
+    alignment_string.erase(remove);
 }
 
-void printSeqNames (std::vector<Chain*>& alignment_string) {
+void printSeqNames (const Msa& alignment_string) {
     for (int i=0; i < int(alignment_string.size()); i++){
         std::cout << "printName in here " << std::to_string(i) << std::endl;
-        std::cout << "printName" << chainGetName(alignment_string[i]) << std::endl;
+        std::cout << "printName" << alignment_string.name(i) << std::endl;
     }
 }
 
 /* add it with seq_weights 1 or pb weights
 with 1 it's raw count, with pb_weights it's weighted */
-void createMatrix(const std::vector<Chain*>& alignment_string, Chain* query,
-    const std::vector<double>& seq_weights, std::vector<std::vector<double>>& matrix,
+void createMatrix(const Msa& alignment_string, bool weighted, ScoreMatrix& matrix,
     std::vector<double>& tot_pos_weight) {
 
-    int query_len = chainGetLength(query);
-    for (uint32_t seq_index = 0; seq_index < alignment_string.size(); seq_index++) {
-        for (int pos = 0; pos < query_len; pos++) {
-            char aa = chainGetChar(alignment_string[seq_index], pos);
-            if (valid_amino_acid(aa)) {
-                int aa_index = (int) aa - (int) 'A';
-                matrix[pos][aa_index] += seq_weights[seq_index] ; /*seq_weight[seq_index];*/
-                tot_pos_weight[pos] += seq_weights[seq_index];
+    int query_len = alignment_string.length();
+    int num_seqs_in_alignment = alignment_string.size();
+    const std::vector<double>& seq_weights = alignment_string.weights();
+
+    for (int pos = 0; pos < query_len; pos++) {
+        const uint8_t* column = alignment_string.column(pos);
+        double* matrix_pos = matrix[pos];
+        for (int seq_index = 0; seq_index < num_seqs_in_alignment; seq_index++) {
+            int aa_index = column[seq_index];
+            if (valid_aa[aa_index]) {
+                double weight = weighted ? seq_weights[seq_index] : 1.0;
+                matrix_pos[aa_index] += weight;
+                tot_pos_weight[pos] += weight;
             }
         }
     }
 }
 
-void printMatrix(std::vector<std::vector<double>>& matrix, std::string filename) {
+void printMatrix(ScoreMatrix& matrix, std::string filename) {
 
-    int query_length = matrix.size();
-    int aas = matrix[0].size();
+    int query_length = matrix.length();
+    int aas = 26;
     std::ofstream out_file;
 
     out_file.open(filename);
@@ -594,35 +765,40 @@ void printMatrix(std::vector<std::vector<double>>& matrix, std::string filename)
     out_file.close();
 }
 
-void printMatrixOriginalFormat(std::vector<std::vector<double>>& matrix, std::string filename) {
+void printMatrixOriginalFormat(const ScoreMatrix& matrix, std::string& dst) {
 
-    auto fp = fopen(filename.c_str(), "w");
+    char buffer[64];
+    auto print = [&](const char* fmt, double value) -> void {
+        int length = snprintf(buffer, sizeof(buffer), fmt, value);
+        dst.append(buffer, length);
+    };
 
-    int query_length = matrix.size();
-    int aas = matrix[0].size();
+    int query_length = matrix.length();
+    int aas = 26;
 
     // print out header
-    fprintf(fp, "ID   UNK_ID; MATRIX\nAC   UNK_AC\nDE   UNK_DE\nMA   UNK_BL\n");
-    fprintf(fp, " ");
+    dst += "ID   UNK_ID; MATRIX\nAC   UNK_AC\nDE   UNK_DE\nMA   UNK_BL\n";
+    dst += " ";
     for (int aa_index = 0; aa_index < aas; aa_index++) {
         // ignore J O U
         if (aa_index != 9 && aa_index != 14 && aa_index != 20) {
-            fprintf(fp, " %c  ", aa_index + 'A');
+            dst += " ";
+            dst += (char) (aa_index + 'A');
+            dst += "  ";
         }
     }
-    fprintf(fp, " *   -\n");
+    dst += " *   -\n";
 
     for (int pos = 0; pos < query_length; pos++) {
         for (int aa_index = 0; aa_index < aas; aa_index++) {
             if (aa_index != 9 && aa_index != 14 && aa_index != 20) {
-                fprintf(fp, " %6.4f ", matrix[pos][aa_index]);
+                print(" %6.4f ", matrix[pos][aa_index]);
             }
         }
-        fprintf(fp, " %6.4f  %6.4f\n", 0.0, 0.0);
+        print(" %6.4f ", 0.0);
+        print(" %6.4f\n", 0.0);
     }
-    fprintf(fp, "//\n");
-
-    fclose(fp);
+    dst += "//\n";
 }
 
 int aa_to_idx(char character){
@@ -630,8 +806,7 @@ int aa_to_idx(char character){
     return int(character) - int('A');
 }
 
-void basic_matrix_construction(const std::vector<Chain*>& alignment_string, const std::vector<double>& seq_weights,
-    std::vector<std::vector<double>>& matrix) {
+void basic_matrix_construction(const Msa& alignment_string, ScoreMatrix& matrix) {
 
     // do partial calculation on aa that can be represented by B or Z as well
     double part_D = aa_frequency[aa_to_idx('D')] / ( aa_frequency[aa_to_idx('D')] + aa_frequency[aa_to_idx('N')] );
@@ -639,16 +814,18 @@ void basic_matrix_construction(const std::vector<Chain*>& alignment_string, cons
     double part_E = aa_frequency[aa_to_idx('E')] / ( aa_frequency[aa_to_idx('E')] + aa_frequency[aa_to_idx('Q')] );
     double part_Q = aa_frequency[aa_to_idx('Q')] / ( aa_frequency[aa_to_idx('E')] + aa_frequency[aa_to_idx('Q')] );
 
-    int proteinLen = chainGetLength(alignment_string[0]);
-    int aaLen =  matrix[0].size();
+    int proteinLen = alignment_string.length();
+    int aaLen = 26;
+    const std::vector<double>& seq_weights = alignment_string.weights();
 
-    // loop every position in chain length
+    // loop every position in alignment length
     for (int pos = 0; pos < proteinLen; pos++){
         double total = 0.0;
+        const uint8_t* column = alignment_string.column(pos);
 
-        // read pos in each chain
+        // read pos in each row
         for (int seq = 0; seq < int(alignment_string.size()); seq++){
-            char currChar = chainGetChar(alignment_string[seq],pos);
+            char currChar = msaDecode(column[seq]);
 
             // parition B between D and N
             if (currChar == 'B') {
@@ -704,16 +881,14 @@ void basic_matrix_construction(const std::vector<Chain*>& alignment_string, cons
     }
 }
 
-void seqs_without_X(const std::vector<Chain*>& alignment_string, int pos, std::vector<Chain*>& out_alignment) {
-
-    char posChar;
-    /*iterate vector of aligment and check pos*/
-    for( int n = 0; n < int(alignment_string.size()); n++){
-        posChar = chainGetChar(alignment_string[n], pos);
+void seqs_without_X(const Msa& alignment_string, int pos, std::vector<uint32_t>& out_rows) {
 
-        /*check if char in pos is valid, and push it into new vector*/
-        if (valid_amino_acid(posChar)){
-            out_alignment.push_back(alignment_string[n]);
+    const uint8_t* column = alignment_string.column(pos);
+    /*iterate rows of aligment and check pos*/
+    for (int n = 0; n < int(alignment_string.size()); n++) {
+        /*check if char in pos is valid, and push its row into new vector*/
+        if (valid_aa[column[n]]) {
+            out_rows.push_back(n);
         }
     }
 }
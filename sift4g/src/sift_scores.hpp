@@ -11,59 +11,104 @@
 #include <stdint.h>
 #include <vector>
 #include <string>
-#include <list>
-#include <unordered_map>
+#include <ostream>
+
+#include "msa.hpp"
+#include "score_matrix.hpp"
 
 #include "swsharp/swsharp.h"
 
-void readSubstFile(char* substFilename, std::list<std::string>& substList);
+/*!
+ * @brief Substitution parsed from a line of a substitution file, e.g. 'A12G'
+ */
+class Substitution {
+public:
+    char ref_aa;
+    int32_t pos; // position in array, starts at 0
+    char alt_aa;
+    std::string token; // first word of the line, printed to the output
+};
+
+/* returns false if the line does not start with a substitution */
+bool parseSubstitution(const std::string& line, Substitution& dst);
+
+/* median sequence info tables hold one value for each query position, positions which are not
+needed are kMedianSeqInfoAbsent and positions waiting for calculation kMedianSeqInfoRequested */
+constexpr double kMedianSeqInfoAbsent = -2.0;
+constexpr double kMedianSeqInfoRequested = -1.0;
 
-void printSubstFile(const std::list<std::string>& substList, std::unordered_map<std::string, double>& medianSeqInfoForPos,
-    const std::vector<std::vector<double>>& SIFTscores, const std::vector<double>& aas_stored,
-    const int total_seq, Chain* query, const std::string outfile);
+/* appends the predictions of the substitutions in SIFT prediction format to dst */
+void printSubstFile(const std::vector<Substitution>& substitutions, const std::vector<double>& medianSeqInfoForPos,
+    const ScoreMatrix& SIFTscores, const std::vector<double>& aas_stored,
+    const int total_seq, Chain* query, std::string& dst);
 
-void createMatrix(const std::vector<Chain*>& alignment_string, Chain* query,
-    const std::vector<double>& seq_weights, std::vector<std::vector<double>>& matrix,
-    std::vector<double>& tot_pos_weight) ;
+/* all routines taking an Msa expect its column-major view to be created */
+void createMatrix(const Msa& alignment_string, bool weighted, ScoreMatrix& matrix,
+    std::vector<double>& tot_pos_weight);
 
-void remove_seqs_percent_identical_to_query(Chain *queries, std::vector<Chain*>& alignment_string, double seq_identity);
+void remove_seqs_percent_identical_to_query(Chain *queries, Msa& alignment_string, double seq_identity);
 
-/* this has to be after createMatrix because it uses amino_acids_present */
-void calcSeqWeights(const std::vector<Chain*>& alignment_string, std::vector<std::vector<double>>& matrix,
-    std::vector<double>& amino_acids_present, std::vector<double>& seq_weights, std::vector<double>& number_of_diff_aas);
+/* fills the zero initialized matrix with raw counts, amino_acids_present with their
+sums and number_of_diff_aas in the same pass over the columns which calculates the
+position-based sequence weights, stores the weights in alignment_string.weights() */
+void calcSeqWeights(Msa& alignment_string, ScoreMatrix& matrix,
+    std::vector<double>& amino_acids_present, std::vector<double>& number_of_diff_aas);
 
-void seqs_without_X(const std::vector<Chain*>& alignment_string, int pos, std::vector<Chain*>& out_alignment);
+void seqs_without_X(const Msa& alignment_string, int pos, std::vector<uint32_t>& out_rows);
 
-void basic_matrix_construction(const std::vector<Chain*>& alignment_string,
-    const std::vector<double>& seq_weights, std::vector<std::vector<double>>& matrix);
+void basic_matrix_construction(const Msa& alignment_string, ScoreMatrix& matrix);
 
 int aa_to_idx(char character);
 
 bool valid_amino_acid(char aa);
 
-double calculateMedianSeqInfo(std::vector<Chain*>& alignment_strings, std::unordered_map<int, int>& invalidSeq,
-    std::vector<double>& seq_weights, std::vector<std::vector<double>>& matrix);
+double calculateMedianSeqInfo(ScoreMatrix& matrix);
+
+void hashPredictedPos(const std::vector<Substitution>& substitutions, std::vector<double>& medianSeqInfoForPos);
+
+void addPosWithDelRef(Chain* query, ScoreMatrix& SIFTscores,
+    std::vector<double>& medianSeqInfoForPos);
+
+/* positions which have valid amino acids in the same set of rows share the median sequence info */
+class MedianSeqInfoGroup {
+public:
+    std::vector<uint32_t> rows;
+    std::vector<uint32_t> positions;
+    double median;
+};
+
+/* groups positions with value kMedianSeqInfoRequested in medianSeqInfoForPos */
+void createMedianSeqInfoGroups(const Msa& alignment_string,
+    const std::vector<double>& medianSeqInfoForPos, std::vector<MedianSeqInfoGroup>& groups);
 
-void hashPredictedPos(std::list<std::string>& substList, std::unordered_map<std::string, double>& medianSeqInfoForPos);
+void calcMedianSeqInfoGroup(const Msa& alignment_string, MedianSeqInfoGroup& group);
 
-void addPosWithDelRef(Chain* query, std::vector<std::vector<double>>& SIFTscores,
-    std::unordered_map<std::string, double>& medianSeqInfoForPos);
+void setMedianSeqInfo(const std::vector<MedianSeqInfoGroup>& groups,
+    std::vector<double>& medianSeqInfoForPos);
 
-void addMedianSeqInfo(std::vector<Chain*>& alignment_string, Chain* query,
-    std::vector<std::vector<double>>& matrix, std::unordered_map<std::string, double>& medianSeqInfoForPos);
+void addMedianSeqInfo(const Msa& alignment_string, std::vector<double>& medianSeqInfoForPos);
 
-void printSeqNames(std::vector<Chain*>& alignment_string);
+void printSeqNames(const Msa& alignment_string);
 
-void check_refaa_against_query(char ref_aa, int aa_pos, Chain* query, std::ofstream& outfp);
+void check_refaa_against_query(char ref_aa, int aa_pos, Chain* query, std::ostream& outfp);
 
-void printMatrixOriginalFormat(std::vector<std::vector<double>>& matrix, std::string filename);
-void printMatrix(std::vector<std::vector<double>>& matrix, std::string filename);
+/* appends the matrix in SIFT prediction format to dst */
+void printMatrixOriginalFormat(const ScoreMatrix& matrix, std::string& dst);
+void printMatrix(ScoreMatrix& matrix, std::string filename);
 
-void calcDiri(std::vector<std::vector<double>>& weighted_matrix, std::vector<std::vector<double>>& diri_matrix);
+/* scores positions [begin, end) independently of other positions, expects the weighted
+matrix created with the weights of calcSeqWeights; if scored_positions is given, only
+those positions and positions where the query amino acid (first row of the alignment)
+may be deleterious are scored exactly, rows of the remaining positions hold lower
+bounds of their scores */
+void calcSIFTScores(const Msa& alignment_string, const ScoreMatrix& seq_weighted_matrix,
+    const std::vector<double>& tot_weights_each_pos, const std::vector<double>& number_of_diff_aas,
+    ScoreMatrix& SIFTscores, const std::vector<bool>* scored_positions, uint32_t begin, uint32_t end);
 
-void calcSIFTScores(std::vector<Chain*>& alignment_string, Chain* query,
-    std::vector<std::vector <double>>& matrix, std::vector<std::vector <double>>& SIFTscores);
+void add_diric_values(const double* count_col, double* diric_col);
 
-void add_diric_values(std::vector<double>& count_col, std::vector<double>& diric_col);
+/* adds Dirichlet pseudocounts of up to 16 columns at once, each column gives the same
+values as add_diric_values */
+void add_diric_values(const double* const* count_cols, double* const* diric_cols, uint32_t cols_length);
 
 double add_logs(double logx, double logy);
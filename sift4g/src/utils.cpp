@@ -9,7 +9,10 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 
 #include "utils.hpp"
 
@@ -32,8 +35,67 @@ int isExtantPath(const char* path) {
     return -1;
 }
 
+void createDirectory(const std::string& path) {
+    ASSERT(mkdir(path.c_str(), 0777) == 0 || errno == EEXIST,
+        "unable to create directory '%s'", path.c_str());
+}
+
+std::string fileFingerprint(const std::string& path) {
+
+    struct stat info;
+    ASSERT(stat(path.c_str(), &info) == 0, "unable to stat file '%s'", path.c_str());
+
+    char* real_path = realpath(path.c_str(), nullptr);
+    ASSERT(real_path, "unable to resolve path '%s'", path.c_str());
+
+    std::string dst = real_path;
+    dst += "\n" + std::to_string((unsigned long long) info.st_size) + " " +
+        std::to_string((long long) info.st_mtim.tv_sec) + "." +
+        std::to_string((long long) info.st_mtim.tv_nsec);
+    free(real_path);
+
+    return dst;
+}
+
+bool readFile(const std::string& path, std::string& dst) {
+
+    FILE* in = fopen(path.c_str(), "rb");
+    if (in == nullptr) {
+        return false;
+    }
+
+    dst.clear();
+
+    char buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        dst.append(buffer, length);
+    }
+
+    bool is_valid = ferror(in) == 0;
+    fclose(in);
+
+    return is_valid;
+}
+
+void replaceFile(const std::string& path, const std::string& data) {
+
+    std::string temporary_path = path + ".tmp";
+
+    FILE* out = fopen(temporary_path.c_str(), "wb");
+    ASSERT(out, "unable to open file '%s'", temporary_path.c_str());
+    ASSERT(fwrite(data.data(), 1, data.size(), out) == data.size() && fclose(out) == 0,
+        "unable to write file '%s'", temporary_path.c_str());
+
+    ASSERT(rename(temporary_path.c_str(), path.c_str()) == 0,
+        "unable to rename file '%s'", temporary_path.c_str());
+}
+
 char* createFileName(const char* name, const std::string& path, const std::string& extension) {
 
+    size_t file_name_length = path.size() + 1 + strlen(name) + extension.size();
+    ASSERT(file_name_length < kBufferSize, "file name too long for '%s'", name);
+
     char* file_name = new char[kBufferSize];
 
     if (!path.empty()) {
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <stdint.h>
+#include <string.h>
 #include <string>
 
 #define ASSERT(expr, fmt, ...)\
@@ -20,6 +22,35 @@
 
 int isExtantPath(const char* path);
 
+/* creates the directory if it does not exist */
+void createDirectory(const std::string& path);
+
+/* resolved path and, on the next line, size and modification time of a file */
+std::string fileFingerprint(const std::string& path);
+
+/* returns false if the file can not be read */
+bool readFile(const std::string& path, std::string& dst);
+
+/* written to a temporary file and renamed, so the file is either missing or whole */
+void replaceFile(const std::string& path, const std::string& data);
+
+/* binary values in native byte order */
+template<typename T>
+void appendValue(std::string& dst, T value) {
+    dst.append((const char*) &value, sizeof(T));
+}
+
+/* returns false if src ends before the value, i is advanced past it */
+template<typename T>
+bool readValue(const std::string& src, uint64_t& i, T& value) {
+    if (i + sizeof(T) > src.size()) {
+        return false;
+    }
+    memcpy(&value, &src[i], sizeof(T));
+    i += sizeof(T);
+    return true;
+}
+
 /* call delete[] after usage */
 char* createFileName(const char* name, const std::string& path, const std::string& extension);
 